@@ -0,0 +1,162 @@
+//***************************************************************************************
+// BenchmarkCommon.h
+//
+// Timing, heap allocation counting and result reporting shared by the benchmarks.
+// Include from exactly one translation unit per executable: it replaces the global
+// operator new/delete.  Results go to stdout as a table, or as JSON with --json.
+//***************************************************************************************
+
+#ifndef BENCHMARKCOMMON_H
+#define BENCHMARKCOMMON_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// The CMake build generates GitCommit.h on every build.
+#ifdef DXCRASH_HAVE_GIT_COMMIT_H
+#include "GitCommit.h"
+#endif
+
+#ifndef DXCRASH_GIT_COMMIT
+#define DXCRASH_GIT_COMMIT "unknown"
+#endif
+
+namespace Benchmark
+{
+	inline std::atomic<size_t>& Allocations()
+	{
+		static std::atomic<size_t> count{0};
+		return count;
+	}
+
+	// A named value reported next to a result, e.g. the pixels each pass shades.
+	struct Counter
+	{
+		std::string Name;
+		double Value;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		double Items;				// Work items per iteration (vertices, pixels, draws...).
+		double NanosecondsPerIteration;
+		double AllocationsPerIteration;
+		std::vector<Counter> Counters;
+	};
+
+	// Runs body() once to warm up, then repetitions batches of iterations calls each,
+	// and keeps the fastest batch.  Allocations are averaged over all timed calls.
+	template<typename F>
+	Result Measure(const char* name, double items, int iterations, int repetitions, F body)
+	{
+		body();
+
+		double best = 1e300;
+		size_t allocations = Allocations().load();
+		for (int r = 0; r < repetitions; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; ++i)
+			{
+				body();
+			}
+			auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+		}
+		allocations = Allocations().load() - allocations;
+
+		Result result;
+		result.Name = name;
+		result.Items = items;
+		result.NanosecondsPerIteration = best;
+		result.AllocationsPerIteration = (double)allocations / ((double)iterations * repetitions);
+		return result;
+	}
+
+	inline bool WantJson(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--json") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	inline void Report(const char* suite, const std::vector<Result>& results, bool json)
+	{
+		if (json)
+		{
+			printf("{\n  \"suite\": \"%s\",\n  \"commit\": \"%s\",\n  \"results\": [\n", suite, DXCRASH_GIT_COMMIT);
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				const Result& r = results[i];
+				printf("    { \"name\": \"%s\", \"items\": %.0f, \"ns_per_iteration\": %.3f, \"ns_per_item\": %.6f, "
+					"\"items_per_second\": %.1f, \"allocations_per_iteration\": %.3f",
+					r.Name.c_str(), r.Items, r.NanosecondsPerIteration, r.NanosecondsPerIteration / r.Items,
+					r.Items * 1e9 / r.NanosecondsPerIteration, r.AllocationsPerIteration);
+				for (const Counter& counter : r.Counters)
+					printf(", \"%s\": %.0f", counter.Name.c_str(), counter.Value);
+				printf(" }%s\n", i + 1 < results.size() ? "," : "");
+			}
+			printf("  ]\n}\n");
+		}
+		else
+		{
+			printf("%s (%s)\n", suite, DXCRASH_GIT_COMMIT);
+			printf("%-36s %14s %12s %14s %12s\n", "benchmark", "ns/iteration", "ns/item", "Mitems/s", "allocs/iter");
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				const Result& r = results[i];
+				printf("%-36s %14.1f %12.4f %14.2f %12.3f", r.Name.c_str(), r.NanosecondsPerIteration,
+					r.NanosecondsPerIteration / r.Items, r.Items * 1e3 / r.NanosecondsPerIteration, r.AllocationsPerIteration);
+				for (const Counter& counter : r.Counters)
+					printf("  %s=%.0f", counter.Name.c_str(), counter.Value);
+				printf("\n");
+			}
+		}
+	}
+}
+
+void* operator new(size_t size)
+{
+	Benchmark::Allocations().fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+#endif // BENCHMARKCOMMON_H
@@ -0,0 +1,28 @@
+# Writes OUTPUT as a header defining DXCRASH_GIT_COMMIT to the short hash of HEAD in
+# SOURCE_DIR.  Runs on every build; the file is only rewritten when the hash changes,
+# so the benchmarks are only recompiled after a new commit.
+#   cmake -DSOURCE_DIR=<dir> -DOUTPUT=<file> -P GitCommit.cmake
+
+set(commit "unknown")
+find_package(Git QUIET)
+if(GIT_FOUND)
+	execute_process(
+		COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+		WORKING_DIRECTORY ${SOURCE_DIR}
+		OUTPUT_VARIABLE output
+		OUTPUT_STRIP_TRAILING_WHITESPACE
+		ERROR_QUIET
+		RESULT_VARIABLE result)
+	if(result EQUAL 0)
+		set(commit ${output})
+	endif()
+endif()
+
+set(content "// Generated by Benchmarks/GitCommit.cmake.\n#define DXCRASH_GIT_COMMIT \"${commit}\"\n")
+set(previous "")
+if(EXISTS ${OUTPUT})
+	file(READ ${OUTPUT} previous)
+endif()
+if(NOT previous STREQUAL content)
+	file(WRITE ${OUTPUT} "${content}")
+endif()
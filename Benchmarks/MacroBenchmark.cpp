@@ -0,0 +1,178 @@
+//***************************************************************************************
+// MacroBenchmark.cpp
+//
+// Renders the app's frame on the CPU backend at several resolutions: clear, queue the
+// RebuildZBuffer and CameraMotionBlur passes, sort, execute.  Mirrors D3DApp::Run(),
+// including that RebuildZBuffer.fx passes the pixel-space quad through as clip space:
+// the y flip makes both triangles counter-clockwise, so back-face culling drops them
+// and pass 0 shades nothing, in the app as here.  Items are the pixels a frame shades,
+// and each result lists the pixels per pass (pass0_pixels, pass1_pixels).
+// Usage: MacroBenchmark [--json] [--frames N]
+//***************************************************************************************
+
+#include "BenchmarkCommon.h"
+
+#include "ConstantBuffers.h"
+#include "CpuBackend.h"
+#include "DrawQueue.h"
+#include "Geometry.h"
+#include "ShaderKernels.h"
+#include "WorkerPool.h"
+
+namespace
+{
+	enum PipelineId
+	{
+		RebuildZBufferPipeline,
+		CameraMotionBlurPipeline,
+		PipelineCount,
+	};
+
+	struct Scene
+	{
+		CpuBufferHandle VertexBuffer;
+		CpuPipeline Pipelines[PipelineCount];
+		DrawQueue Queue;
+
+		Scene() :
+			Queue(16)
+		{
+		}
+	};
+
+	void CreateScene(CpuDevice& device, Scene& scene)
+	{
+		VertexPositionTexture quad[4];
+		BuildQuad(QuadRect{ 0, 0, 1600, 900 }, 0, 0, 1, 1, quad);
+		scene.VertexBuffer = device.CreateBuffer(quad, sizeof(quad));
+
+		RebuildZBufferConstants rebuildConstants = {};
+		CameraMotionBlurConstants blurConstants = {};
+
+		// Same states as D3DApp::InitDirect3D(); the rasterizer state is the D3D11 default.
+		CpuPipeline& rebuild = scene.Pipelines[RebuildZBufferPipeline];
+		rebuild.Shader.VS = RebuildZBufferVS;
+		rebuild.Shader.PS = RebuildZBufferPS;
+		rebuild.Shader.VSBuffer = device.CreateBuffer(&rebuildConstants, sizeof(rebuildConstants));
+		rebuild.Shader.PSBuffer = device.CreateBuffer(&rebuildConstants, sizeof(rebuildConstants));
+		rebuild.DepthState.DepthEnable = true;
+		rebuild.DepthState.DepthWrite = true;
+		rebuild.DepthState.DepthFunc = CpuComparisonLessEqual;
+		rebuild.CullMode = CpuCullBack;
+
+		CpuPipeline& blur = scene.Pipelines[CameraMotionBlurPipeline];
+		blur.Shader.VS = CameraMotionBlurVS;
+		blur.Shader.PS = CameraMotionBlurPS;
+		blur.Shader.VSBuffer = device.CreateBuffer(&blurConstants, sizeof(blurConstants));
+		blur.Shader.PSBuffer = device.CreateBuffer(&blurConstants, sizeof(blurConstants));
+		blur.DepthState.DepthEnable = false;
+		blur.DepthState.DepthWrite = false;
+		blur.DepthState.DepthFunc = CpuComparisonLessEqual;
+		blur.CullMode = CpuCullBack;
+	}
+
+	// Counts how often each pixel is shaded.
+	void CountPS(const void*, const PixelSpan& span, uint32_t* colors)
+	{
+		for (int i = 0; i < span.Count; ++i)
+			++colors[i];
+	}
+
+	// When passPixels is given, every pass shades with CountPS instead and its pixel
+	// count is added to passPixels[pass].
+	void RenderFrame(CpuDevice& device, Scene& scene, WorkerPool* workers, uint64_t* passPixels = nullptr)
+	{
+		static const float black[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		device.ClearRenderTarget(black);
+		device.ClearDepthStencil(1.0f, 0);
+
+		scene.Queue.Reset();
+		scene.Queue.Submit(DrawKey::Make(0, RebuildZBufferPipeline, 0, 0), 0);
+		scene.Queue.Submit(DrawKey::Make(1, CameraMotionBlurPipeline, 0, 0), 0);
+		scene.Queue.Sort(workers);
+
+		device.SetVertexBuffer(scene.VertexBuffer);
+		uint32_t pipeline = 0xFFFFFFFF;
+		for (const DrawItem& item : scene.Queue)
+		{
+			uint32_t itemPipeline = DrawKey::Pipeline(item.Key);
+			if (passPixels)
+			{
+				static const float zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				CpuPipeline counting = scene.Pipelines[itemPipeline];
+				counting.Shader.PS = CountPS;
+				device.ClearRenderTarget(zero);
+				device.SetPipeline(counting);
+				device.Draw(4, 0);
+
+				const uint32_t* counts = device.ColorData();
+				uint64_t pixels = 0;
+				for (size_t i = 0; i < (size_t)device.Width() * device.Height(); ++i)
+					pixels += counts[i];
+				passPixels[DrawKey::Pass(item.Key)] += pixels;
+				pipeline = 0xFFFFFFFF;
+				continue;
+			}
+
+			if (itemPipeline != pipeline)
+			{
+				device.SetPipeline(scene.Pipelines[itemPipeline]);
+				pipeline = itemPipeline;
+			}
+			device.Draw(4, 0);
+		}
+
+		device.EndFrame();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int frames = 20;
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "--frames") == 0)
+			frames = std::max(1, atoi(argv[i + 1]));
+	}
+
+	struct Resolution
+	{
+		const char* Name;
+		int Width;
+		int Height;
+	};
+
+	const Resolution resolutions[] =
+	{
+		{ "frame/640x360", 640, 360 },
+		{ "frame/1280x720", 1280, 720 },
+		{ "frame/1600x900", 1600, 900 },
+		{ "frame/1920x1080", 1920, 1080 },
+	};
+
+	WorkerPool workers;
+	std::vector<Benchmark::Result> results;
+
+	for (const Resolution& resolution : resolutions)
+	{
+		CpuDevice device(&workers);
+		device.Resize(resolution.Width, resolution.Height);
+
+		Scene scene;
+		CreateScene(device, scene);
+
+		uint64_t passPixels[2] = {};
+		RenderFrame(device, scene, &workers, passPixels);
+
+		Benchmark::Result result = Benchmark::Measure(resolution.Name, (double)(passPixels[0] + passPixels[1]), frames, 3, [&]
+		{
+			RenderFrame(device, scene, &workers);
+		});
+		result.Counters.push_back(Benchmark::Counter{ "pass0_pixels", (double)passPixels[0] });
+		result.Counters.push_back(Benchmark::Counter{ "pass1_pixels", (double)passPixels[1] });
+		results.push_back(result);
+	}
+
+	Benchmark::Report("macro", results, Benchmark::WantJson(argc, argv));
+	return 0;
+}
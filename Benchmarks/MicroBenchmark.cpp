@@ -0,0 +1,439 @@
+//***************************************************************************************
+// MicroBenchmark.cpp
+//
+// Per-kernel throughput and heap allocations of the rendering core.
+// Usage: MicroBenchmark [--json]
+//***************************************************************************************
+
+#include "BenchmarkCommon.h"
+
+#include "ConstantBuffers.h"
+#include "CpuBackend.h"
+#include "DrawQueue.h"
+#include "Geometry.h"
+#include "ResourcePool.h"
+#include "ShaderKernels.h"
+#include "Status.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+	// Stands in for IDXGISwapChain::Present; volatile keeps the checks alive.
+	volatile int32_t gResult = 0;
+
+	int32_t Present()
+	{
+		return gResult;
+	}
+
+	struct NullDeleter
+	{
+		void operator()(uint32_t) const
+		{
+		}
+	};
+
+	void StatusBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		results.push_back(Benchmark::Measure("status/throw_if_failed", 1, 1000000, 5, []
+		{
+			ThrowIfFailedAs(StatusException, Present());
+		}));
+
+		results.push_back(Benchmark::Measure("status/log_if_failed", 1, 1000000, 5, []
+		{
+			LogIfFailed(Present());
+		}));
+
+		static const SourceLocation location = { __FILE__, "ErrorRing", __LINE__ };
+		results.push_back(Benchmark::Measure("status/error_ring_push_pop", 1, 1000000, 5, []
+		{
+			ErrorRecord record;
+			GlobalErrorRing().Push(-1, &location);
+			GlobalErrorRing().Pop(record);
+		}));
+	}
+
+	void PoolBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		const size_t count = 100000;
+
+		static ResourcePool<uint32_t, NullDeleter> pool;
+		static std::vector<Handle<uint32_t>> handles;
+		pool.Reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+			handles.push_back(pool.Create(i));
+
+		// Punch holes so that lookups go through a shuffled slot table.
+		std::mt19937 random(1);
+		for (size_t i = 0; i < count / 4; ++i)
+			pool.Destroy(handles[random() % count], 0);
+		pool.Collect(0);
+		std::shuffle(handles.begin(), handles.end(), random);
+
+		results.push_back(Benchmark::Measure("pool/get_100k", (double)count, 20, 5, [&]
+		{
+			uint32_t sum = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (const uint32_t* value = pool.Get(handles[i]))
+					sum += *value;
+			}
+			gResult = (int32_t)sum;
+		}));
+	}
+
+	void DrawQueueBenchmarks(std::vector<Benchmark::Result>& results, WorkerPool& workers)
+	{
+		const size_t count = 100000;
+
+		static std::vector<uint64_t> keys(count);
+		std::mt19937 random(2);
+		for (size_t i = 0; i < count; ++i)
+			keys[i] = DrawKey::Make(random() % 4, random() % 64, random() % 1024, random() & 0xFFFFFF);
+
+		static DrawQueue queue(count);
+		auto submit = [&]
+		{
+			queue.Reset();
+			DrawQueue::Writer writer(queue);
+			for (size_t i = 0; i < count; ++i)
+				writer.Submit(keys[i], (uint32_t)i);
+		};
+		results.push_back(Benchmark::Measure("drawqueue/submit_100k", (double)count, 20, 5, submit));
+
+		results.push_back(Benchmark::Measure("drawqueue/sort_100k", (double)count, 1, 20, [&]
+		{
+			submit();
+			queue.Sort();
+		}));
+
+		results.push_back(Benchmark::Measure("drawqueue/sort_100k_parallel", (double)count, 1, 20, [&]
+		{
+			submit();
+			queue.Sort(&workers);
+		}));
+	}
+
+	void GeometryBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		const size_t count = 10000;
+
+		static std::vector<QuadRect> rects(count);
+		static std::vector<VertexPositionTexture> vertices(4 * count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			QuadRect rect = { (float)(i % 100), (float)(i / 100), (float)(i % 100 + 16), (float)(i / 100 + 16) };
+			rects[i] = rect;
+		}
+
+		results.push_back(Benchmark::Measure("geometry/build_quads_10k", (double)count, 100, 5, [&]
+		{
+			BuildQuads(rects.data(), count, 0, 0, 1, 1, vertices.data());
+		}));
+
+		// 24-byte vertices against their 12-byte forms.  Snorm positions need [-1, 1].
+		static std::vector<VertexPositionTexture> normalized(4 * count);
+		static std::vector<VertexPositionTextureHalf> halves(4 * count);
+		static std::vector<VertexPositionTextureSnorm> snorms(4 * count);
+		for (size_t i = 0; i < normalized.size(); ++i)
+		{
+			normalized[i] = vertices[i];
+			normalized[i].Position[0] /= 128.0f;
+			normalized[i].Position[1] /= 128.0f;
+		}
+
+		results.push_back(Benchmark::Measure("geometry/pack_half_40k", 4.0 * count, 100, 5, [&]
+		{
+			PackVertices(vertices.data(), 4 * count, halves.data());
+		}));
+
+		results.push_back(Benchmark::Measure("geometry/unpack_half_40k", 4.0 * count, 100, 5, [&]
+		{
+			UnpackVertices(halves.data(), 4 * count, vertices.data());
+		}));
+
+		results.push_back(Benchmark::Measure("geometry/pack_snorm_40k", 4.0 * count, 100, 5, [&]
+		{
+			PackVertices(normalized.data(), 4 * count, snorms.data());
+		}));
+
+		results.push_back(Benchmark::Measure("geometry/unpack_snorm_40k", 4.0 * count, 100, 5, [&]
+		{
+			UnpackVertices(snorms.data(), 4 * count, normalized.data());
+		}));
+	}
+
+	void KernelBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		const size_t vertexCount = 65536;
+		const int spanWidth = 1920, spanRows = 64;
+
+		static std::vector<VertexPositionTexture> input(vertexCount);
+		static std::vector<VertexOutput> output(vertexCount);
+		static std::vector<uint32_t> colors(spanWidth);
+		for (size_t i = 0; i < vertexCount; i += 4)
+			BuildQuad(QuadRect{ 0, 0, 1600, 900 }, 0, 0, 1, 1, &input[i]);
+
+		static RebuildZBufferConstants rebuildConstants = { { 0.25f, 0.5f, 0.75f, 1 } };
+		static CameraMotionBlurConstants blurConstants = {};
+
+		results.push_back(Benchmark::Measure("kernels/rebuild_zbuffer_vs", (double)vertexCount, 100, 5, [&]
+		{
+			RebuildZBufferVS(&rebuildConstants, input.data(), output.data(), vertexCount);
+		}));
+
+		results.push_back(Benchmark::Measure("kernels/camera_motion_blur_vs", (double)vertexCount, 100, 5, [&]
+		{
+			CameraMotionBlurVS(&blurConstants, input.data(), output.data(), vertexCount);
+		}));
+
+		PixelSpan span = {};
+		span.Count = spanWidth;
+
+		results.push_back(Benchmark::Measure("kernels/rebuild_zbuffer_ps", (double)spanWidth * spanRows, 100, 5, [&]
+		{
+			for (int row = 0; row < spanRows; ++row)
+				RebuildZBufferPS(&rebuildConstants, span, colors.data());
+		}));
+
+		results.push_back(Benchmark::Measure("kernels/camera_motion_blur_ps", (double)spanWidth * spanRows, 100, 5, [&]
+		{
+			for (int row = 0; row < spanRows; ++row)
+				CameraMotionBlurPS(&blurConstants, span, colors.data());
+		}));
+	}
+
+	void SampleBilinearNaive(const uint32_t* image, int width, int height, float u, float v, float color[4])
+	{
+		float fx = u * width - 0.5f, fy = v * height - 0.5f;
+		int x0 = (int)std::floor(fx), y0 = (int)std::floor(fy);
+		float tx = fx - x0, ty = fy - y0;
+		int xs[2] = { std::min(std::max(x0, 0), width - 1), std::min(std::max(x0 + 1, 0), width - 1) };
+		int ys[2] = { std::min(std::max(y0, 0), height - 1), std::min(std::max(y0 + 1, 0), height - 1) };
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			float c[4];
+			for (int corner = 0; corner < 4; ++corner)
+				c[corner] = (float)((image[ys[corner >> 1] * width + xs[corner & 1]] >> (8 * channel)) & 255) / 255.0f;
+			color[channel] = (c[0] + (c[1] - c[0]) * tx) * (1 - ty) + (c[2] + (c[3] - c[2]) * tx) * ty;
+		}
+	}
+
+	// Motion-blur style gathers over a 1600x900 source: every pixel of a 1600x64 block
+	// takes eight taps along a fixed direction, once per layout and format.
+	void TextureBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		const int width = 1600, height = 900, rows = 64, taps = 8;
+
+		static std::vector<uint32_t> image((size_t)width * height);
+		std::mt19937 random(3);
+		for (uint32_t& texel : image)
+			texel = random();
+
+		struct Case
+		{
+			const char* Name;
+			TextureFormat Format;
+			TextureLayout Layout;
+			float StepX;
+			float StepY;
+			bool Bilinear;
+		};
+
+		const Case cases[] =
+		{
+			{ "texture/point_rgba_tiled", TextureFormatR8G8B8A8Unorm, TextureLayoutTiled, 0, 0, false },
+			{ "texture/point_rgba_swizzled", TextureFormatR8G8B8A8Unorm, TextureLayoutSwizzled, 0, 0, false },
+			{ "texture/point_rgba_linear", TextureFormatR8G8B8A8Unorm, TextureLayoutLinear, 0, 0, false },
+			{ "texture/bilinear_rgba_tiled", TextureFormatR8G8B8A8Unorm, TextureLayoutTiled, 0, 0, true },
+			{ "texture/bilinear_rgba_swizzled", TextureFormatR8G8B8A8Unorm, TextureLayoutSwizzled, 0, 0, true },
+			{ "texture/bilinear_rgba_linear", TextureFormatR8G8B8A8Unorm, TextureLayoutLinear, 0, 0, true },
+			{ "texture/blur_vertical_rgba_tiled", TextureFormatR8G8B8A8Unorm, TextureLayoutTiled, 0, 1, true },
+			{ "texture/blur_vertical_rgba_swizzled", TextureFormatR8G8B8A8Unorm, TextureLayoutSwizzled, 0, 1, true },
+			{ "texture/blur_vertical_rgba_linear", TextureFormatR8G8B8A8Unorm, TextureLayoutLinear, 0, 1, true },
+			{ "texture/blur_diagonal_rgba_tiled", TextureFormatR8G8B8A8Unorm, TextureLayoutTiled, 1, 1, true },
+			{ "texture/blur_diagonal_rgba_swizzled", TextureFormatR8G8B8A8Unorm, TextureLayoutSwizzled, 1, 1, true },
+			{ "texture/blur_diagonal_rgba_linear", TextureFormatR8G8B8A8Unorm, TextureLayoutLinear, 1, 1, true },
+			{ "texture/taps_vertical_d24_point_tiled", TextureFormatD24UnormS8Uint, TextureLayoutTiled, 0, 1, false },
+			{ "texture/taps_vertical_d24_point_linear", TextureFormatD24UnormS8Uint, TextureLayoutLinear, 0, 1, false },
+		};
+
+		static Texture texture;
+		for (const Case& c : cases)
+		{
+			texture.Create(width, height, c.Format, 1, c.Layout);
+			texture.Upload(image.data(), width);
+
+			// A tap per pixel for point/bilinear, taps per pixel for the blurs.
+			const int tapCount = (c.StepX != 0 || c.StepY != 0) ? taps : 1;
+			const float stepU = 3.0f * c.StepX / width, stepV = 3.0f * c.StepY / height;
+			results.push_back(Benchmark::Measure(c.Name, (double)width * rows * tapCount, 5, 5, [&]
+			{
+				float u[8], v[8], sum = 0;
+				Color8 color;
+				for (int y = 0; y < rows; ++y)
+				{
+					for (int x = 0; x < width; x += 8)
+					{
+						for (int i = 0; i < 8; ++i)
+						{
+							u[i] = (x + i + 0.5f) / width;
+							v[i] = (y * 12 + 0.5f) / height;
+						}
+						for (int tap = 0; tap < tapCount; ++tap)
+						{
+							if (c.Bilinear)
+								texture.SampleBilinear8(0, u, v, color);
+							else
+								texture.SamplePoint8(0, u, v, color);
+							sum += color.R[0];
+							for (int i = 0; i < 8; ++i)
+							{
+								u[i] += stepU;
+								v[i] += stepV;
+							}
+						}
+					}
+				}
+				gResult = (int32_t)sum;
+			}));
+		}
+
+		// Baseline: one pixel at a time from the row-major image, as a straightforward
+		// port of the HLSL would do it.
+		results.push_back(Benchmark::Measure("texture/blur_vertical_rgba_naive", (double)width * rows * taps, 5, 5, [&]
+		{
+			float sum = 0;
+			for (int y = 0; y < rows; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					float u = (x + 0.5f) / width, v = (y * 12 + 0.5f) / height;
+					for (int tap = 0; tap < taps; ++tap, v += 3.0f / height)
+					{
+						float color[4];
+						SampleBilinearNaive(image.data(), width, height, u, v, color);
+						sum += color[0];
+					}
+				}
+			}
+			gResult = (int32_t)sum;
+		}));
+	}
+
+	// Long streaks over a 16384x8192 RGBA surface (512 MiB, more than the last-level
+	// cache), where the layout decides how many cache lines and pages a sample touches.
+	// Output pixels lie on every 64th line of the surface, traversed in 8-wide spans
+	// along Traverse; each takes eight bilinear taps 4 texels apart along Taps.  Angles
+	// are in degrees; Mixed picks a new tap direction for every span, as a per-pixel
+	// velocity would.  Positions wrap around the surface.
+	void LargeTextureBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		const int width = 16384, height = 8192, spacing = 64, length = 8192, taps = 8;
+		const float tapStep = 4.0f, pi = 3.14159265f;
+
+		struct Case
+		{
+			const char* Name;
+			float Traverse;
+			float Taps;
+			bool Mixed;
+		};
+
+		const Case cases[] =
+		{
+			{ "rows", 0, 90, false },
+			{ "columns", 90, 0, false },
+			{ "diagonal", 30, 120, false },
+			{ "mixed", 0, 0, true },
+		};
+
+		const TextureLayout layouts[] = { TextureLayoutTiled, TextureLayoutSwizzled, TextureLayoutLinear };
+		const char* layoutNames[] = { "tiled", "swizzled", "linear" };
+
+		static Texture texture;
+		for (int l = 0; l < 3; ++l)
+		{
+			texture.Create(width, height, TextureFormatR8G8B8A8Unorm, 1, layouts[l]);
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+					texture.SetTexel(0, x, y, (uint32_t)(x * 2654435761u) ^ (uint32_t)(y * 40503u));
+			}
+
+			for (const Case& c : cases)
+			{
+				const float sx = std::cos(c.Traverse * pi / 180), sy = std::sin(c.Traverse * pi / 180);
+				const int lines = (c.Traverse == 90 ? width : height) / spacing;
+
+				std::string name = std::string("texture/streak_") + c.Name + "_" + layoutNames[l];
+				results.push_back(Benchmark::Measure(name.c_str(), (double)lines * length * taps, 1, 3, [&]
+				{
+					std::mt19937 random(7);
+					std::uniform_real_distribution<float> angle(0, 2 * pi);
+					float u[8], v[8], sum = 0;
+					Color8 color;
+					for (int line = 0; line < lines; ++line)
+					{
+						// Lines are spacing apart across the traversal direction.
+						float ox = -sy * spacing * (line + 0.5f), oy = sx * spacing * (line + 0.5f);
+						for (int i = 0; i < length; i += 8)
+						{
+							float tapAngle = c.Mixed ? angle(random) : c.Taps * pi / 180;
+							float dx = std::cos(tapAngle) * tapStep, dy = std::sin(tapAngle) * tapStep;
+							for (int tap = 0; tap < taps; ++tap)
+							{
+								for (int k = 0; k < 8; ++k)
+								{
+									float x = ox + sx * (i + k) + dx * tap, y = oy + sy * (i + k) + dy * tap;
+									u[k] = (x - std::floor(x / width) * width) / width;
+									v[k] = (y - std::floor(y / height) * height) / height;
+								}
+								texture.SampleBilinear8(0, u, v, color);
+								sum += color.R[0];
+							}
+						}
+					}
+					gResult = (int32_t)sum;
+				}));
+			}
+		}
+		texture = Texture();
+	}
+
+	void BackendBenchmarks(std::vector<Benchmark::Result>& results)
+	{
+		static CpuDevice device;
+		device.Resize(1920, 1080);
+
+		static const float black[] = { 0, 0, 0, 1 };
+		results.push_back(Benchmark::Measure("cpu/clear_1080p", 1920.0 * 1080.0, 20, 5, []
+		{
+			device.ClearRenderTarget(black);
+			device.ClearDepthStencil(1.0f, 0);
+		}));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	WorkerPool workers;
+	std::vector<Benchmark::Result> results;
+
+	StatusBenchmarks(results);
+	PoolBenchmarks(results);
+	DrawQueueBenchmarks(results, workers);
+	GeometryBenchmarks(results);
+	KernelBenchmarks(results);
+	TextureBenchmarks(results);
+	LargeTextureBenchmarks(results);
+	BackendBenchmarks(results);
+
+	Benchmark::Report("micro", results, Benchmark::WantJson(argc, argv));
+	return 0;
+}
@@ -0,0 +1,32 @@
+//***************************************************************************************
+// ConstantBuffers.h
+//
+// C++ mirrors of the effect constant buffers, laid out with HLSL packing rules
+// (no member may straddle a 16-byte register; array elements start a new register).
+//***************************************************************************************
+
+#ifndef CONSTANTBUFFERS_H
+#define CONSTANTBUFFERS_H
+
+// RebuildZBuffer.fx: float4 Color;
+struct RebuildZBufferConstants
+{
+	float Color[4];
+};
+
+// CameraMotionBlur.fx: float3 FrustumCorners[4];
+struct CameraMotionBlurConstants
+{
+	struct Corner
+	{
+		float X, Y, Z;
+		float Padding;
+	};
+
+	Corner FrustumCorners[4];
+};
+
+static_assert(sizeof(RebuildZBufferConstants) == 16, "RebuildZBuffer.fx constant buffer is one register.");
+static_assert(sizeof(CameraMotionBlurConstants) == 64, "CameraMotionBlur.fx constant buffer is four registers.");
+
+#endif // CONSTANTBUFFERS_H
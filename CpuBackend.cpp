@@ -0,0 +1,402 @@
+//***************************************************************************************
+// CpuBackend.cpp
+//***************************************************************************************
+
+#include "CpuBackend.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const uint32_t DepthMax = 0xFFFFFF;
+
+	// D3D11 snaps vertex positions to 1/256 of a pixel; they are kept in those units.
+	const int SubpixelBits = 8;
+	const int64_t SubpixelOne = (int64_t)1 << SubpixelBits;
+	const int64_t SubpixelHalf = SubpixelOne / 2;
+
+	// Keeps the edge functions within int64.  Positions this far out (2^21 pixels) are
+	// clamped; the image inside any realistic viewport does not change.
+	const float GuardBand = (float)(1 << 29);
+
+	inline int64_t Snap(float value)
+	{
+		float snapped = std::floor(value * (float)SubpixelOne + 0.5f);
+		return (int64_t)std::min(std::max(snapped, -GuardBand), GuardBand);
+	}
+
+	// Pixel containing a position given in subpixels.
+	inline int64_t PixelFloor(int64_t value)
+	{
+		return value >= 0 ? value / SubpixelOne : -((-value + SubpixelOne - 1) / SubpixelOne);
+	}
+
+	// Float has too little precision to round 24-bit values correctly near 1.
+	inline uint32_t ToDepth24(float depth)
+	{
+		double value = std::min(std::max((double)depth, 0.0), 1.0);
+		return (uint32_t)(value * DepthMax + 0.5);
+	}
+
+	inline bool Compare(CpuComparison func, uint32_t source, uint32_t dest)
+	{
+		switch (func)
+		{
+		case CpuComparisonNever:        return false;
+		case CpuComparisonLess:         return source < dest;
+		case CpuComparisonEqual:        return source == dest;
+		case CpuComparisonLessEqual:    return source <= dest;
+		case CpuComparisonGreater:      return source > dest;
+		case CpuComparisonNotEqual:     return source != dest;
+		case CpuComparisonGreaterEqual: return source >= dest;
+		default:                        return true;
+		}
+	}
+
+	struct ScreenVertex
+	{
+		int64_t X, Y;
+		float Z;
+		const VertexOutput* Attributes;
+	};
+}
+
+CpuDevice::CpuDevice(WorkerPool* pool) :
+	mPool(pool),
+	mWidth(0),
+	mHeight(0),
+	mBands(1),
+	mFrameIndex(0),
+	mVertexStride(sizeof(VertexPositionTexture)),
+	mVertexUnpacker(nullptr),
+	mPipeline()
+{
+	for (int i = 0; i < PixelTextureSlots; ++i)
+		mTextures[i] = nullptr;
+}
+
+void CpuDevice::Resize(int width, int height)
+{
+	mWidth = width;
+	mHeight = height;
+	mColor.assign((size_t)width * height, 0);
+	mDepthStencil.assign((size_t)width * height, DepthMax);
+
+	// A few bands per thread keeps the load balanced when coverage is uneven.
+	int bands = mPool ? (int)mPool->Concurrency() * 4 : 1;
+	mBands = std::max(1, std::min(bands, height));
+}
+
+CpuBufferHandle CpuDevice::CreateBuffer(const void* data, size_t size)
+{
+	CpuBuffer buffer;
+	buffer.Data.resize(size);
+	if (data)
+		memcpy(buffer.Data.data(), data, size);
+
+	return mBuffers.Create(std::move(buffer));
+}
+
+void CpuDevice::UpdateBuffer(CpuBufferHandle handle, const void* data, size_t size)
+{
+	CpuBuffer* buffer = mBuffers.Get(handle);
+	if (buffer)
+		memcpy(buffer->Data.data(), data, std::min(size, buffer->Data.size()));
+}
+
+void CpuDevice::DestroyBuffer(CpuBufferHandle buffer)
+{
+	mBuffers.Destroy(buffer, mFrameIndex);
+}
+
+void CpuDevice::ClearRenderTarget(const float color[4])
+{
+	std::fill(mColor.begin(), mColor.end(), PackR8G8B8A8(color));
+}
+
+void CpuDevice::ClearDepthStencil(float depth, uint8_t stencil)
+{
+	std::fill(mDepthStencil.begin(), mDepthStencil.end(), ToDepth24(depth) | ((uint32_t)stencil << 24));
+}
+
+void CpuDevice::SetVertexBuffer(CpuBufferHandle buffer)
+{
+	BindVertexBuffer(buffer, sizeof(VertexPositionTexture), nullptr);
+}
+
+void CpuDevice::BindVertexBuffer(CpuBufferHandle buffer, unsigned stride, CpuVertexUnpacker unpacker)
+{
+	mVertexBuffer = buffer;
+	mVertexStride = stride;
+	mVertexUnpacker = unpacker;
+}
+
+void CpuDevice::SetTexture(int slot, const Texture* texture)
+{
+	if (slot >= 0 && slot < PixelTextureSlots)
+		mTextures[slot] = texture;
+}
+
+void CpuDevice::SetPipeline(const CpuPipeline& pipeline)
+{
+	mPipeline = pipeline;
+}
+
+void CpuDevice::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+	const CpuBuffer* vertexBuffer = mBuffers.Get(mVertexBuffer);
+	if (!vertexBuffer || vertexCount < 3 || mWidth == 0 || mHeight == 0)
+		return;
+
+	size_t available = vertexBuffer->Data.size() / mVertexStride;
+	if (startVertex + (size_t)vertexCount > available)
+		return;
+
+	const CpuBuffer* vsBuffer = mBuffers.Get(mPipeline.Shader.VSBuffer);
+	const uint8_t* data = vertexBuffer->Data.data() + (size_t)startVertex * mVertexStride;
+	const VertexPositionTexture* vertices = reinterpret_cast<const VertexPositionTexture*>(data);
+	if (mVertexUnpacker)
+	{
+		mUnpacked.resize(vertexCount);
+		mVertexUnpacker(data, vertexCount, mUnpacked.data());
+		vertices = mUnpacked.data();
+	}
+
+	mTransformed.resize(vertexCount);
+	mPipeline.Shader.VS(vsBuffer ? vsBuffer->Data.data() : nullptr, vertices, mTransformed.data(), vertexCount);
+
+	// Odd triangles of a strip swap their first two vertices to keep the winding.
+	mTriangles.clear();
+	for (uint32_t i = 0; i + 2 < vertexCount; ++i)
+	{
+		if (i & 1)
+			SetupTriangle(mTransformed[i + 1], mTransformed[i], mTransformed[i + 2]);
+		else
+			SetupTriangle(mTransformed[i], mTransformed[i + 1], mTransformed[i + 2]);
+	}
+
+	if (mTriangles.empty())
+		return;
+
+	auto rasterize = [this](unsigned band) { RasterizeBand((int)band); };
+	if (mPool)
+	{
+		mPool->ParallelFor((unsigned)mBands, rasterize);
+	}
+	else
+	{
+		for (int band = 0; band < mBands; ++band)
+			RasterizeBand(band);
+	}
+}
+
+void CpuDevice::EndFrame()
+{
+	mBuffers.Collect(mFrameIndex);
+	++mFrameIndex;
+}
+
+void CpuDevice::SetupTriangle(const VertexOutput& v0, const VertexOutput& v1, const VertexOutput& v2)
+{
+	const VertexOutput* input[3] = { &v0, &v1, &v2 };
+	ScreenVertex v[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		// No near-plane clipping: triangles reaching behind the eye are dropped.
+		float w = input[i]->Position[3];
+		if (!(w > 0.0f))
+			return;
+
+		float invW = 1.0f / w;
+		float x = (input[i]->Position[0] * invW + 1.0f) * 0.5f * (float)mWidth;
+		float y = (1.0f - input[i]->Position[1] * invW) * 0.5f * (float)mHeight;
+		if (x != x || y != y)
+			return;
+
+		v[i].X = Snap(x);
+		v[i].Y = Snap(y);
+		v[i].Z = input[i]->Position[2] * invW;
+		v[i].Attributes = input[i];
+	}
+
+	// Positive area is clockwise on screen, which D3D treats as front facing.
+	int64_t area = (v[1].X - v[0].X) * (v[2].Y - v[0].Y) - (v[1].Y - v[0].Y) * (v[2].X - v[0].X);
+	if (area == 0)
+		return;
+	if (area < 0 && mPipeline.CullMode == CpuCullBack)
+		return;
+	if (area > 0 && mPipeline.CullMode == CpuCullFront)
+		return;
+	if (area < 0)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	Triangle t;
+	t.MinX = (int)std::max<int64_t>(0, PixelFloor(std::min(v[0].X, std::min(v[1].X, v[2].X))));
+	t.MinY = (int)std::max<int64_t>(0, PixelFloor(std::min(v[0].Y, std::min(v[1].Y, v[2].Y))));
+	t.MaxX = (int)std::min<int64_t>(mWidth - 1, PixelFloor(std::max(v[0].X, std::max(v[1].X, v[2].X))));
+	t.MaxY = (int)std::min<int64_t>(mHeight - 1, PixelFloor(std::max(v[0].Y, std::max(v[1].Y, v[2].Y))));
+	if (t.MinX > t.MaxX || t.MinY > t.MaxY)
+		return;
+
+	// Edge i runs from v[i] to v[i + 1] and is >= 0 on the inside.  Pixel centres
+	// exactly on an edge belong to the triangle only if the edge is a top or left edge.
+	Plane edges[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		const ScreenVertex& a = v[i];
+		const ScreenVertex& b = v[(i + 1) % 3];
+		int64_t dx = b.X - a.X, dy = b.Y - a.Y;
+		bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+
+		t.Edges[i].A = -dy;
+		t.Edges[i].B = dx;
+		t.Edges[i].C = dy * a.X - dx * a.Y - (topLeft ? 0 : 1);
+
+		// The same edge in pixel units, without the bias, for the attribute planes.
+		edges[i].A = (float)(-dy / (double)SubpixelOne);
+		edges[i].B = (float)(dx / (double)SubpixelOne);
+		edges[i].C = (float)((dy * a.X - dx * a.Y) / (double)(SubpixelOne * SubpixelOne));
+	}
+
+	// The barycentric weight of v[i] is the edge opposite to it over the area.
+	float invArea = (float)((double)(SubpixelOne * SubpixelOne) / (double)area);
+	auto makePlane = [&](float f0, float f1, float f2)
+	{
+		const float f[3] = { f0, f1, f2 };
+		Plane plane = { 0, 0, 0 };
+		for (int i = 0; i < 3; ++i)
+		{
+			const Plane& edge = edges[(i + 1) % 3];
+			float weight = f[i] * invArea;
+			plane.A += edge.A * weight;
+			plane.B += edge.B * weight;
+			plane.C += edge.C * weight;
+		}
+		return plane;
+	};
+
+	const VertexOutput& a0 = *v[0].Attributes;
+	const VertexOutput& a1 = *v[1].Attributes;
+	const VertexOutput& a2 = *v[2].Attributes;
+	t.Depth = makePlane(v[0].Z, v[1].Z, v[2].Z);
+	for (int i = 0; i < 2; ++i)
+		t.TexCoord[i] = makePlane(a0.TexCoord[i], a1.TexCoord[i], a2.TexCoord[i]);
+	for (int i = 0; i < 3; ++i)
+		t.FrustumRay[i] = makePlane(a0.FrustumRay[i], a1.FrustumRay[i], a2.FrustumRay[i]);
+
+	mTriangles.push_back(t);
+}
+
+void CpuDevice::RasterizeBand(int band)
+{
+	int rowsPerBand = (mHeight + mBands - 1) / mBands;
+	int bandBegin = band * rowsPerBand;
+	int bandEnd = std::min(mHeight, bandBegin + rowsPerBand);
+
+	const CpuBuffer* psBuffer = mBuffers.Get(mPipeline.Shader.PSBuffer);
+	const void* psConstants = psBuffer ? psBuffer->Data.data() : nullptr;
+	const CpuDepthStencilState& depthState = mPipeline.DepthState;
+
+	for (size_t ti = 0; ti < mTriangles.size(); ++ti)
+	{
+		const Triangle& t = mTriangles[ti];
+		int y0 = std::max(t.MinY, bandBegin);
+		int y1 = std::min(t.MaxY + 1, bandEnd);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			float px = (float)t.MinX + 0.5f;
+			float py = (float)y + 0.5f;
+
+			// Edges are stepped in integers, so shared edges stay exact along the row.
+			int64_t ex = t.MinX * SubpixelOne + SubpixelHalf;
+			int64_t ey = y * SubpixelOne + SubpixelHalf;
+			int64_t e[3], step[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				e[i] = t.Edges[i].A * ex + t.Edges[i].B * ey + t.Edges[i].C;
+				step[i] = t.Edges[i].A * SubpixelOne;
+			}
+			float z = t.Depth.A * px + t.Depth.B * py + t.Depth.C;
+
+			uint32_t* colorRow = &mColor[(size_t)y * mWidth];
+			uint32_t* depthRow = &mDepthStencil[(size_t)y * mWidth];
+
+			int runStart = -1;
+			bool entered = false;
+			auto flush = [&](int end)
+			{
+				PixelSpan span;
+				span.Textures = mTextures;
+				span.X = runStart;
+				span.Y = y;
+				span.Count = end - runStart;
+
+				float sx = (float)runStart + 0.5f;
+				for (int i = 0; i < 2; ++i)
+				{
+					span.TexCoord[i] = t.TexCoord[i].A * sx + t.TexCoord[i].B * py + t.TexCoord[i].C;
+					span.TexCoordDx[i] = t.TexCoord[i].A;
+				}
+				for (int i = 0; i < 3; ++i)
+				{
+					span.FrustumRay[i] = t.FrustumRay[i].A * sx + t.FrustumRay[i].B * py + t.FrustumRay[i].C;
+					span.FrustumRayDx[i] = t.FrustumRay[i].A;
+				}
+
+				mPipeline.Shader.PS(psConstants, span, colorRow + runStart);
+				runStart = -1;
+			};
+
+			for (int x = t.MinX; x <= t.MaxX; ++x)
+			{
+				bool covered = (e[0] | e[1] | e[2]) >= 0;
+
+				bool passed = false;
+				if (covered)
+				{
+					entered = true;
+
+					// Depth clipping, then the depth test against the quantized value.
+					passed = z >= 0.0f && z <= 1.0f;
+					if (passed && depthState.DepthEnable)
+					{
+						uint32_t depth = ToDepth24(z);
+						uint32_t stored = depthRow[x];
+						passed = Compare(depthState.DepthFunc, depth, stored & DepthMax);
+						if (passed && depthState.DepthWrite)
+							depthRow[x] = (stored & ~DepthMax) | depth;
+					}
+				}
+
+				if (passed)
+				{
+					if (runStart < 0)
+						runStart = x;
+				}
+				else
+				{
+					if (runStart >= 0)
+						flush(x);
+
+					// Triangles are convex: once we leave, the rest of the row is outside.
+					if (!covered && entered)
+						break;
+				}
+
+				for (int i = 0; i < 3; ++i)
+					e[i] += step[i];
+				z += t.Depth.A;
+			}
+
+			if (runStart >= 0)
+				flush(t.MaxX + 1);
+		}
+	}
+}
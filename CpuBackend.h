@@ -0,0 +1,189 @@
+//***************************************************************************************
+// CpuBackend.h
+//
+// Software implementation of the subset of the D3D11 pipeline the app uses: triangle
+// strips of VertexPositionTexture (or one of its compact forms), shader kernels from
+// ShaderKernels.h, an R8G8B8A8_UNORM render target and a D24_UNORM_S8_UINT depth
+// buffer.  Rasterization follows the D3D11 rules (positions snapped to 1/256 pixel,
+// pixel centres, top-left fill rule, back-face culling by default); coverage is
+// computed in integers on the snapped positions, so triangles sharing an edge never
+// overlap or leave gaps.
+// Attributes are interpolated linearly in screen space, which is exact for the w = 1
+// full-screen quads the effects draw.  Stencil operations are not emulated.
+// Pixel kernels sample Texture objects bound with SetTexture().
+//***************************************************************************************
+
+#ifndef CPUBACKEND_H
+#define CPUBACKEND_H
+
+#include "Geometry.h"
+#include "ResourcePool.h"
+#include "ShaderKernels.h"
+
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Expands count compact vertices to VertexPositionTexture.
+typedef void (*CpuVertexUnpacker)(const void* input, size_t count, VertexPositionTexture* output);
+
+// Values match D3D11_COMPARISON_FUNC.
+enum CpuComparison
+{
+	CpuComparisonNever = 1,
+	CpuComparisonLess = 2,
+	CpuComparisonEqual = 3,
+	CpuComparisonLessEqual = 4,
+	CpuComparisonGreater = 5,
+	CpuComparisonNotEqual = 6,
+	CpuComparisonGreaterEqual = 7,
+	CpuComparisonAlways = 8,
+};
+
+// Values match D3D11_CULL_MODE.
+enum CpuCullMode
+{
+	CpuCullNone = 1,
+	CpuCullFront = 2,
+	CpuCullBack = 3,
+};
+
+struct CpuDepthStencilState
+{
+	bool DepthEnable;
+	bool DepthWrite;
+	CpuComparison DepthFunc;
+};
+
+struct CpuBuffer
+{
+	std::vector<uint8_t> Data;
+};
+
+struct CpuBufferDeleter
+{
+	void operator()(CpuBuffer& buffer) const
+	{
+		std::vector<uint8_t>().swap(buffer.Data);
+	}
+};
+
+typedef ResourcePool<CpuBuffer, CpuBufferDeleter> CpuBufferPool;
+typedef CpuBufferPool::HandleType CpuBufferHandle;
+
+struct CpuShader
+{
+	VertexKernel VS;
+	PixelKernel PS;
+	CpuBufferHandle VSBuffer;
+	CpuBufferHandle PSBuffer;
+};
+
+struct CpuPipeline
+{
+	CpuShader Shader;
+	CpuDepthStencilState DepthState;
+	CpuCullMode CullMode;
+};
+
+class CpuDevice
+{
+public:
+	// Rasterization is split into row bands across pool when one is given.
+	explicit CpuDevice(WorkerPool* pool = nullptr);
+
+	CpuDevice(const CpuDevice&) = delete;
+	CpuDevice& operator=(const CpuDevice&) = delete;
+
+	void Resize(int width, int height);
+
+	CpuBufferHandle CreateBuffer(const void* data, size_t size);
+	void UpdateBuffer(CpuBufferHandle buffer, const void* data, size_t size);
+
+	// The buffer is freed once the frame in which it was destroyed has ended.
+	void DestroyBuffer(CpuBufferHandle buffer);
+
+	void ClearRenderTarget(const float color[4]);
+	void ClearDepthStencil(float depth, uint8_t stencil);
+
+	void SetVertexBuffer(CpuBufferHandle buffer);
+
+	// Binds a buffer of compact vertices (VertexPositionTextureHalf, ...); draws
+	// unpack them before running the vertex kernel.
+	template<typename Vertex>
+	void SetVertexBuffer(CpuBufferHandle buffer)
+	{
+		BindVertexBuffer(buffer, Vertex::Layout::Stride, [](const void* input, size_t count, VertexPositionTexture* output)
+		{
+			UnpackVertices(static_cast<const Vertex*>(input), count, output);
+		});
+	}
+
+	// Binds a texture for pixel kernels to sample; the device does not own it.
+	void SetTexture(int slot, const Texture* texture);
+	void SetPipeline(const CpuPipeline& pipeline);
+
+	// Draws a triangle strip from the bound vertex buffer.
+	void Draw(uint32_t vertexCount, uint32_t startVertex);
+
+	// The CPU backend executes synchronously, so everything retired so far is free to go.
+	void EndFrame();
+
+	int Width()const { return mWidth; }
+	int Height()const { return mHeight; }
+	const uint32_t* ColorData()const { return mColor.data(); }
+	const uint32_t* DepthStencilData()const { return mDepthStencil.data(); }
+
+private:
+	void BindVertexBuffer(CpuBufferHandle buffer, unsigned stride, CpuVertexUnpacker unpacker);
+
+	// A*x + B*y + C, evaluated at pixel centres.
+	struct Plane
+	{
+		float A, B, C;
+	};
+
+	// A*x + B*y + C in 1/256-pixel units, exact for snapped vertices.  C includes the
+	// fill-rule bias, so a pixel centre is covered where all three edges are >= 0.
+	struct Edge
+	{
+		int64_t A, B, C;
+	};
+
+	// Screen-space setup of one front-facing (after culling) triangle.
+	struct Triangle
+	{
+		int MinX, MinY, MaxX, MaxY;
+		Edge Edges[3];
+		Plane Depth;
+		Plane TexCoord[2];
+		Plane FrustumRay[3];
+	};
+
+	void SetupTriangle(const VertexOutput& v0, const VertexOutput& v1, const VertexOutput& v2);
+	void RasterizeBand(int band);
+
+	WorkerPool* mPool;
+	int mWidth;
+	int mHeight;
+	int mBands;
+	uint64_t mFrameIndex;
+
+	std::vector<uint32_t> mColor;
+	std::vector<uint32_t> mDepthStencil;
+
+	CpuBufferPool mBuffers;
+	CpuBufferHandle mVertexBuffer;
+	unsigned mVertexStride;
+	CpuVertexUnpacker mVertexUnpacker;
+	CpuPipeline mPipeline;
+	const Texture* mTextures[PixelTextureSlots];
+
+	// Per-draw scratch, kept to avoid allocating on every draw.
+	std::vector<VertexPositionTexture> mUnpacked;
+	std::vector<VertexOutput> mTransformed;
+	std::vector<Triangle> mTriangles;
+};
+
+#endif // CPUBACKEND_H
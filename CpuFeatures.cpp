@@ -0,0 +1,97 @@
+//***************************************************************************************
+// CpuFeatures.cpp
+//***************************************************************************************
+
+#include "CpuFeatures.h"
+
+#include <atomic>
+
+#if defined(DXCRASH_HAVE_AVX2)
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if defined(DXCRASH_HAVE_AVX2)
+	void Cpuid(int leaf, int subleaf, unsigned registers[4])
+	{
+#if defined(_MSC_VER)
+		int values[4];
+		__cpuidex(values, leaf, subleaf);
+		for (int i = 0; i < 4; ++i)
+			registers[i] = (unsigned)values[i];
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	unsigned long long ReadXcr0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+
+	bool DetectAvx2()
+	{
+		unsigned registers[4];
+		Cpuid(0, 0, registers);
+		if (registers[0] < 7)
+			return false;
+
+		// Leaf 1 ECX: FMA (12), OSXSAVE (27), AVX (28), F16C (29).
+		Cpuid(1, 0, registers);
+		const unsigned required = (1u << 12) | (1u << 27) | (1u << 28) | (1u << 29);
+		if ((registers[2] & required) != required)
+			return false;
+
+		// The OS must save the XMM and YMM state on context switches.
+		if ((ReadXcr0() & 6) != 6)
+			return false;
+
+		// Leaf 7 EBX: AVX2 (5).
+		Cpuid(7, 0, registers);
+		return (registers[1] & (1u << 5)) != 0;
+	}
+#endif
+
+	SimdLevel DetectSimdLevel()
+	{
+#if defined(DXCRASH_HAVE_AVX2)
+		if (DetectAvx2())
+			return SimdLevelAvx2;
+#endif
+		return SimdLevelScalar;
+	}
+
+	std::atomic<int>& ActiveLevel()
+	{
+		static std::atomic<int> level{ (int)SupportedSimdLevel() };
+		return level;
+	}
+}
+
+SimdLevel SupportedSimdLevel()
+{
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+SimdLevel ActiveSimdLevel()
+{
+	return (SimdLevel)ActiveLevel().load(std::memory_order_relaxed);
+}
+
+void SetSimdLevel(SimdLevel level)
+{
+	ActiveLevel().store(level < SupportedSimdLevel() ? level : SupportedSimdLevel(), std::memory_order_relaxed);
+}
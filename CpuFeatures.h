@@ -0,0 +1,29 @@
+//***************************************************************************************
+// CpuFeatures.h
+//
+// Runtime selection of the SIMD kernels.  The AVX2 kernels are compiled in when the
+// build enables them (DXCRASH_HAVE_AVX2) but only used once CPUID and XGETBV confirm
+// that the CPU and the OS support AVX2, F16C and FMA, so the same binary runs on any
+// x86-64 machine.
+//***************************************************************************************
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+enum SimdLevel
+{
+	SimdLevelScalar,
+	SimdLevelAvx2,
+};
+
+// Highest level that is both compiled in and supported by this machine.
+SimdLevel SupportedSimdLevel();
+
+// Level the kernels dispatch on.  Starts at SupportedSimdLevel().
+SimdLevel ActiveSimdLevel();
+
+// Forces a lower level, e.g. to compare the scalar and SIMD paths.  Requests above
+// SupportedSimdLevel() are clamped to it.
+void SetSimdLevel(SimdLevel level);
+
+#endif // CPUFEATURES_H
@@ -6,6 +6,7 @@
 #include <WindowsX.h>
 #include <sstream>
 #include <assert.h>
+#include <utility>
 #include <vector>
 
 namespace
@@ -14,6 +15,34 @@ namespace
 	// procedure to our member function window procedure because we cannot
 	// assign a member function to WNDCLASS::lpfnWndProc.
 	D3DApp* gd3dApp = 0;
+
+	static_assert(VertexFormatR32G32B32A32Float == DXGI_FORMAT_R32G32B32A32_FLOAT &&
+		VertexFormatR32G32B32Float == DXGI_FORMAT_R32G32B32_FLOAT &&
+		VertexFormatR16G16B16A16Float == DXGI_FORMAT_R16G16B16A16_FLOAT &&
+		VertexFormatR16G16B16A16Snorm == DXGI_FORMAT_R16G16B16A16_SNORM &&
+		VertexFormatR32G32Float == DXGI_FORMAT_R32G32_FLOAT &&
+		VertexFormatR16G16Float == DXGI_FORMAT_R16G16_FLOAT &&
+		VertexFormatR16G16Unorm == DXGI_FORMAT_R16G16_UNORM, "VertexFormat must match DXGI_FORMAT.");
+
+	// Per-vertex input elements for slot 0, a constant table generated from Vertex::Layout.
+	template<typename Vertex, typename Indices = std::make_index_sequence<Vertex::Layout::ElementCount>>
+	struct InputLayoutDesc;
+
+	template<typename Vertex, size_t... Indices>
+	struct InputLayoutDesc<Vertex, std::index_sequence<Indices...>>
+	{
+		static const UINT Count = Vertex::Layout::ElementCount;
+
+		static constexpr D3D11_INPUT_ELEMENT_DESC Elements[] =
+		{
+			{ Vertex::Layout::InputElements[Indices].SemanticName, Vertex::Layout::InputElements[Indices].SemanticIndex,
+				(DXGI_FORMAT)Vertex::Layout::InputElements[Indices].Format, 0, Vertex::Layout::InputElements[Indices].AlignedByteOffset,
+				D3D11_INPUT_PER_VERTEX_DATA, 0 }...
+		};
+	};
+
+	template<typename Vertex, size_t... Indices>
+	constexpr D3D11_INPUT_ELEMENT_DESC InputLayoutDesc<Vertex, std::index_sequence<Indices...>>::Elements[];
 }
 
 LRESULT CALLBACK
@@ -42,7 +71,9 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 	mSwapChain(0),
 	mDepthStencilBuffer(0),
 	mRenderTargetView(0),
-	mDepthStencilView(0)
+	mDepthStencilView(0),
+	mFrameIndex(0),
+	mDrawQueue(DrawQueueCapacity)
 {
 	ZeroMemory(&mScreenViewport, sizeof(D3D11_VIEWPORT));
 
@@ -54,6 +85,13 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 
 D3DApp::~D3DApp()
 {
+	// Nothing is in flight once we get here, so release the pooled resources now.
+	mBuffers.DestroyAll();
+	mVertexShaders.DestroyAll();
+	mPixelShaders.DestroyAll();
+	mInputLayouts.DestroyAll();
+	mDepthStencilStates.DestroyAll();
+
 	ReleaseCOM(mRenderTargetView);
 	ReleaseCOM(mDepthStencilView);
 	ReleaseCOM(mSwapChain);
@@ -97,30 +135,27 @@ int D3DApp::Run()
 			context->ClearRenderTargetView(mRenderTargetView, black);
 			context->ClearDepthStencilView(mDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-			// Vertex Buffer
-			UINT stride = sizeof(VertexPositionTexture), offset = 0;
-			context->IASetVertexBuffers(0, 1, &mVB, &stride, &offset);
 			context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 
-			// Shader/DepthState 1
-			context->OMSetDepthStencilState(mDS1, 0);
-			context->VSSetShader(mShader1.mVS, nullptr, 0);
-			context->PSSetShader(mShader1.mPS, nullptr, 0);
-			context->IASetInputLayout(mShader1.mInput);
-			context->VSSetConstantBuffers(0, 1, &mShader1.mVSBuffer);
-			context->PSSetConstantBuffers(0, 1, &mShader1.mPSBuffer);
-			context->Draw(4, 0);
-
-			// Shader/DepthState 2
-			context->OMSetDepthStencilState(mDS2, 0);
-			context->VSSetShader(mShader2.mVS, nullptr, 0);
-			context->PSSetShader(mShader2.mPS, nullptr, 0);
-			context->IASetInputLayout(mShader2.mInput);
-			context->VSSetConstantBuffers(0, 1, &mShader2.mVSBuffer);
-			context->PSSetConstantBuffers(0, 1, &mShader2.mPSBuffer);
-			context->Draw(4, 0);
+			// Pass 0 rebuilds the Z buffer, pass 1 applies the motion blur.
+			mDrawQueue.Reset();
+			mDrawQueue.Submit(DrawKey::Make(0, RebuildZBufferPipeline, 0, 0), FullScreenQuadDraw);
+			mDrawQueue.Submit(DrawKey::Make(1, CameraMotionBlurPipeline, 0, 0), FullScreenQuadDraw);
+			// A handful of draws per frame: the serial sort is enough, and the repro
+			// should not run extra threads.
+			mDrawQueue.Sort(nullptr);
+			ExecuteDraws();
 
 			ThrowIfFailed(mSwapChain->Present(0, 0));
+			++mFrameIndex;
+			CollectResources();
+
+			// Report non-fatal errors. Strings are only built when there is something to report.
+			ErrorRecord error;
+			while (GlobalErrorRing().Pop(error))
+			{
+				OutputDebugStringW((ToString(error) + L"\n").c_str());
+			}
 		}
     }
 
@@ -373,7 +408,97 @@ bool D3DApp::InitMainWindow()
 	return true;
 }
 
-ID3D11Buffer* D3DApp::CreateConstantBuffer(int bufferSize) const
+bool D3DApp::BindShader(const Shader& shader, DepthStencilStateHandle depthState)
+{
+	// Pool lookups hand back the stored pointers; no AddRef/Release on the draw path.
+	ID3D11DepthStencilState* const* state = mDepthStencilStates.Get(depthState);
+	ID3D11VertexShader* const* vertexShader = mVertexShaders.Get(shader.mVS);
+	ID3D11PixelShader* const* pixelShader = mPixelShaders.Get(shader.mPS);
+	ID3D11InputLayout* const* inputLayout = mInputLayouts.Get(shader.mInput);
+	ID3D11Buffer* const* vsBuffer = mBuffers.Get(shader.mVSBuffer);
+	ID3D11Buffer* const* psBuffer = mBuffers.Get(shader.mPSBuffer);
+	if (!state || !vertexShader || !pixelShader || !inputLayout || !vsBuffer || !psBuffer)
+	{
+		LogIfFailed(StatusInvalidHandle);
+		return false;
+	}
+
+	context->OMSetDepthStencilState(*state, 0);
+	context->VSSetShader(*vertexShader, nullptr, 0);
+	context->PSSetShader(*pixelShader, nullptr, 0);
+	context->IASetInputLayout(*inputLayout);
+	context->VSSetConstantBuffers(0, 1, vsBuffer);
+	context->PSSetConstantBuffers(0, 1, psBuffer);
+	return true;
+}
+
+void D3DApp::ExecuteDraws()
+{
+	// Draws arrive sorted by pass, then pipeline, so state only changes between runs.
+	// Draws that reference destroyed resources are skipped; the failure is recorded
+	// once per pipeline run or vertex buffer change.
+	uint32_t pipeline = 0xFFFFFFFF;
+	bool pipelineBound = false;
+	BufferHandle vertexBuffer;
+	bool vertexBufferBound = false;
+	for (const DrawItem& item : mDrawQueue)
+	{
+		uint32_t itemPipeline = DrawKey::Pipeline(item.Key);
+		if (itemPipeline != pipeline)
+		{
+			pipelineBound = BindShader(mPipelines[itemPipeline].mShader, mPipelines[itemPipeline].mDepthState);
+			pipeline = itemPipeline;
+		}
+
+		const DrawCommand& command = mDrawCommands[item.Payload];
+		if (command.mVB != vertexBuffer)
+		{
+			ID3D11Buffer* const* buffer = mBuffers.Get(command.mVB);
+			vertexBufferBound = buffer != nullptr;
+			if (vertexBufferBound)
+			{
+				UINT stride = VertexPositionTexture::Layout::Stride, offset = 0;
+				context->IASetVertexBuffers(0, 1, buffer, &stride, &offset);
+			}
+			else
+			{
+				LogIfFailed(StatusInvalidHandle);
+			}
+			vertexBuffer = command.mVB;
+		}
+
+		if (!pipelineBound || !vertexBufferBound)
+			continue;
+
+		context->Draw(command.mVertexCount, command.mStartVertex);
+	}
+}
+
+void D3DApp::DestroyShader(const Shader& shader)
+{
+	// The current frame may still reference the shader.
+	mVertexShaders.Destroy(shader.mVS, mFrameIndex);
+	mPixelShaders.Destroy(shader.mPS, mFrameIndex);
+	mInputLayouts.Destroy(shader.mInput, mFrameIndex);
+	mBuffers.Destroy(shader.mVSBuffer, mFrameIndex);
+	mBuffers.Destroy(shader.mPSBuffer, mFrameIndex);
+}
+
+void D3DApp::CollectResources()
+{
+	// Frame N has been consumed by the GPU once FramesInFlight further frames were presented.
+	if (mFrameIndex <= FramesInFlight)
+		return;
+
+	uint64_t completed = mFrameIndex - FramesInFlight - 1;
+	mBuffers.Collect(completed);
+	mVertexShaders.Collect(completed);
+	mPixelShaders.Collect(completed);
+	mInputLayouts.Collect(completed);
+	mDepthStencilStates.Collect(completed);
+}
+
+BufferHandle D3DApp::CreateConstantBuffer(int bufferSize)
 {
 	// https://learn.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-resources-buffers-constant-how-to
 	D3D11_BUFFER_DESC desc;
@@ -402,10 +527,10 @@ ID3D11Buffer* D3DApp::CreateConstantBuffer(int bufferSize) const
 	ID3D11Buffer* result;
 	ThrowIfFailed(md3dDevice->CreateBuffer(&desc, &InitData, &result));
 
-	return result;
+	return mBuffers.Create(result);
 }
 
-Shader D3DApp::CreateShader(const std::wstring& filename, int bufferSize) const
+Shader D3DApp::CreateShader(const std::wstring& filename, int bufferSize)
 {
 	Shader result;
 
@@ -415,21 +540,27 @@ Shader D3DApp::CreateShader(const std::wstring& filename, int bufferSize) const
 	ID3DBlob* errorBlob = nullptr;
 	// Compile Vertex and Pixel shaders
 	ThrowIfFailed(D3DCompileFromFile(filename.c_str(), NULL, NULL, "VS", "vs_4_0", flags, 0, &shaderBlob, &errorBlob));
-	ThrowIfFailed(md3dDevice->CreateVertexShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), NULL, &result.mVS));
+	ID3D11VertexShader* vertexShader;
+	ThrowIfFailed(md3dDevice->CreateVertexShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), NULL, &vertexShader));
+	result.mVS = mVertexShaders.Create(vertexShader);
 
 	ID3DBlob* vertexBlob = shaderBlob;
-	shaderBlob = errorBlob = nullptr;
+	ReleaseCOM(errorBlob);
+	shaderBlob = nullptr;
 	ThrowIfFailed(D3DCompileFromFile(filename.c_str(), NULL, NULL, "PS", "ps_4_0", flags, 0, &shaderBlob, &errorBlob));
-	ThrowIfFailed(md3dDevice->CreatePixelShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), NULL, &result.mPS));
+	ID3D11PixelShader* pixelShader;
+	ThrowIfFailed(md3dDevice->CreatePixelShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), NULL, &pixelShader));
+	result.mPS = mPixelShaders.Create(pixelShader);
+	ReleaseCOM(shaderBlob);
+	ReleaseCOM(errorBlob);
 
 
-	D3D11_INPUT_ELEMENT_DESC quadLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
+	typedef InputLayoutDesc<VertexPositionTexture> QuadLayout;
 
-	ThrowIfFailed(md3dDevice->CreateInputLayout(quadLayout, 2, vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(), &result.mInput));
+	ID3D11InputLayout* inputLayout;
+	ThrowIfFailed(md3dDevice->CreateInputLayout(QuadLayout::Elements, QuadLayout::Count, vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(), &inputLayout));
+	result.mInput = mInputLayouts.Create(inputLayout);
+	ReleaseCOM(vertexBlob);
 
 	result.mVSBuffer = CreateConstantBuffer(bufferSize);
 	result.mPSBuffer = CreateConstantBuffer(bufferSize);
@@ -438,7 +569,7 @@ Shader D3DApp::CreateShader(const std::wstring& filename, int bufferSize) const
 	return result;
 }
 
-ID3D11Buffer* D3DApp::CreateVertexBuffer(const RECT& rectangle, const POINTF& texCoordTopLeft, const POINTF& texCoordBottomRight) const
+BufferHandle D3DApp::CreateVertexBuffer(const RECT& rectangle, const POINTF& texCoordTopLeft, const POINTF& texCoordBottomRight)
 {
 
 	D3D11_BUFFER_DESC desc;
@@ -452,46 +583,17 @@ ID3D11Buffer* D3DApp::CreateVertexBuffer(const RECT& rectangle, const POINTF& te
 	ID3D11Buffer* result;
 	ThrowIfFailed(md3dDevice->CreateBuffer(&desc, nullptr, &result));
 
-	float left = (float)rectangle.left;
-	float top = (float)rectangle.top;
-	float bottom = (float)rectangle.bottom;
-	float right = (float)rectangle.right;
+	QuadRect rect = { (float)rectangle.left, (float)rectangle.top, (float)rectangle.right, (float)rectangle.bottom };
 
 	VertexPositionTexture data[4];
-	data[0].Position[0] = left;
-	data[0].Position[1] = top;
-	data[0].Position[2] = 0;
-	data[0].Position[3] = 1;
-	data[0].TexCoord[0] = texCoordTopLeft.x;
-	data[0].TexCoord[1] = texCoordTopLeft.y;
-	
-	data[1].Position[0] = right;
-	data[1].Position[1] = top;
-	data[1].Position[2] = 0;
-	data[1].Position[3] = 1;
-	data[1].TexCoord[0] = texCoordBottomRight.x;
-	data[1].TexCoord[1] = texCoordTopLeft.y;
-
-	data[2].Position[0] = left;
-	data[2].Position[1] = bottom;
-	data[2].Position[2] = 0;
-	data[2].Position[3] = 1;
-	data[2].TexCoord[0] = texCoordTopLeft.x;
-	data[2].TexCoord[1] = texCoordBottomRight.y;
-
-	data[3].Position[0] = right;
-	data[3].Position[1] = bottom;
-	data[3].Position[2] = 0;
-	data[3].Position[3] = 1;
-	data[3].TexCoord[0] = texCoordBottomRight.x;
-	data[3].TexCoord[1] = texCoordBottomRight.y;
+	BuildQuad(rect, texCoordTopLeft.x, texCoordTopLeft.y, texCoordBottomRight.x, texCoordBottomRight.y, data);
 
 	D3D11_MAPPED_SUBRESOURCE dataBox;
 	ThrowIfFailed(context->Map(result, 0, D3D11_MAP_WRITE_DISCARD, 0, &dataBox));
 	memcpy(dataBox.pData, &data, 4 * sizeof(VertexPositionTexture));
 	context->Unmap(result, 0);
 
-	return result;
+	return mBuffers.Create(result);
 }
 
 
@@ -588,8 +690,8 @@ bool D3DApp::InitDirect3D()
 	
 	OnResize();
 
-	mShader1 = CreateShader(L"RebuildZBuffer.fx", 16);
-	mShader2 = CreateShader(L"CameraMotionBlur.fx", 64);
+	Shader rebuildZBuffer = CreateShader(L"RebuildZBuffer.fx", sizeof(RebuildZBufferConstants));
+	Shader cameraMotionBlur = CreateShader(L"CameraMotionBlur.fx", sizeof(CameraMotionBlurConstants));
 
 	RECT r;
 	r.left = 0;
@@ -606,6 +708,9 @@ bool D3DApp::InitDirect3D()
 	bottomRight.y = 1;
 	mVB = CreateVertexBuffer(r, topLeft, bottomRight);
 
+	DrawCommand quad = { mVB, 4, 0 };
+	mDrawCommands.push_back(quad);
+
 	CD3D11_DEPTH_STENCIL_DESC desc;
 	memset(&desc, 0, sizeof(desc));
 	desc.DepthEnable = 1;
@@ -622,13 +727,19 @@ bool D3DApp::InitDirect3D()
 	desc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
 	desc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
 
-	md3dDevice->CreateDepthStencilState(&desc, &mDS1);
+	ID3D11DepthStencilState* depthState;
+	ThrowIfFailed(md3dDevice->CreateDepthStencilState(&desc, &depthState));
+	Pipeline pipeline = { rebuildZBuffer, mDepthStencilStates.Create(depthState) };
+	mPipelines.push_back(pipeline);
 
 	desc.DepthEnable = 0;
 	desc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 	desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
 
-	md3dDevice->CreateDepthStencilState(&desc, &mDS2);
+	ThrowIfFailed(md3dDevice->CreateDepthStencilState(&desc, &depthState));
+	pipeline.mShader = cameraMotionBlur;
+	pipeline.mDepthState = mDepthStencilStates.Create(depthState);
+	mPipelines.push_back(pipeline);
 
 	return true;
 }
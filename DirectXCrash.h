@@ -15,67 +15,112 @@
 #include <d3dcompiler.h>
 #include <comdef.h>
 #include <string>
+#include <vector>
 #include <windows.h>
 #include <wrl.h>
 
+#include "ConstantBuffers.h"
+#include "DrawQueue.h"
+#include "Geometry.h"
+#include "ResourcePool.h"
+#include "Status.h"
+
 #define ReleaseCOM(x) { if(x){ x->Release(); x = 0; } }
 
+// Deleter for pools of COM interface pointers.
+struct ComDeleter
+{
+	void operator()(IUnknown* p) const
+	{
+		if (p)
+			p->Release();
+	}
+};
+
+typedef ResourcePool<ID3D11Buffer*, ComDeleter> BufferPool;
+typedef ResourcePool<ID3D11VertexShader*, ComDeleter> VertexShaderPool;
+typedef ResourcePool<ID3D11PixelShader*, ComDeleter> PixelShaderPool;
+typedef ResourcePool<ID3D11InputLayout*, ComDeleter> InputLayoutPool;
+typedef ResourcePool<ID3D11DepthStencilState*, ComDeleter> DepthStencilStatePool;
+
+typedef BufferPool::HandleType BufferHandle;
+typedef VertexShaderPool::HandleType VertexShaderHandle;
+typedef PixelShaderPool::HandleType PixelShaderHandle;
+typedef InputLayoutPool::HandleType InputLayoutHandle;
+typedef DepthStencilStatePool::HandleType DepthStencilStateHandle;
+
+inline std::wstring AnsiToWString(const std::string& str)
+{
+	WCHAR buffer[512];
+	MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, buffer, 512);
+	return std::wstring(buffer);
+}
+
 class DxException
 {
 public:
-	DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
+	DxException(HRESULT hr, const SourceLocation& location) :
 		ErrorCode(hr),
-		FunctionName(functionName),
-		Filename(filename),
-		LineNumber(lineNumber)
+		Location(&location)
 	{
 	}
 
+	// Formatting is deferred to here so that the throw site never allocates.
 	std::wstring ToString()const
 	{
 		// Get the string description of the error code.
 		_com_error err(ErrorCode);
 		std::wstring msg = err.ErrorMessage();
 
-		return FunctionName + L" failed in " + Filename + L"; line " + std::to_wstring(LineNumber) + L"; error: " + msg;
+		return AnsiToWString(Location->Expression) + L" failed in " + AnsiToWString(Location->File) +
+			L"; line " + std::to_wstring(Location->Line) + L"; error: " + msg;
 	}
 
 	HRESULT ErrorCode = S_OK;
-	std::wstring FunctionName;
-	std::wstring Filename;
-	int LineNumber = -1;
+	const SourceLocation* Location = nullptr;
 };
 
-inline std::wstring AnsiToWString(const std::string& str)
+inline std::wstring ToString(const ErrorRecord& record)
 {
-	WCHAR buffer[512];
-	MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, buffer, 512);
-	return std::wstring(buffer);
+	return DxException(record.Code, *record.Location).ToString();
 }
 
 #ifndef ThrowIfFailed
-#define ThrowIfFailed(x)                                              \
-{                                                                     \
-    HRESULT hr__ = (x);                                               \
-    std::wstring wfn = AnsiToWString(__FILE__);                       \
-    if(FAILED(hr__)) { throw DxException(hr__, L#x, wfn, __LINE__); } \
+#define ThrowIfFailed(x)                                                         \
+{                                                                                \
+    HRESULT hr__ = (x);                                                          \
+    if(FAILED(hr__))                                                             \
+    {                                                                            \
+        static const SourceLocation loc__ = { __FILE__, #x, __LINE__ };          \
+        throw DxException(hr__, loc__);                                          \
+    }                                                                            \
 }
 #endif
 
-struct VertexPositionTexture
+// Handles into the D3DApp resource pools; cheap to copy.
+class Shader
 {
-	float Position[4];
-	float TexCoord[2];
+public:
+	VertexShaderHandle mVS;
+	PixelShaderHandle mPS;
+	InputLayoutHandle mInput;
+	BufferHandle mVSBuffer;
+	BufferHandle mPSBuffer;
 };
 
-class Shader
+// What a draw key's pipeline field refers to.
+struct Pipeline
 {
-public:
-	ID3D11VertexShader* mVS;
-	ID3D11PixelShader* mPS;
-	ID3D11InputLayout* mInput;
-	ID3D11Buffer* mVSBuffer;
-	ID3D11Buffer* mPSBuffer;
+	Shader mShader;
+	DepthStencilStateHandle mDepthState;
+};
+
+// What a draw item's payload refers to.
+struct DrawCommand
+{
+	BufferHandle mVB;
+	UINT mVertexCount;
+	UINT mStartVertex;
 };
 
 class D3DApp
@@ -101,12 +146,38 @@ public:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
 
-	Shader CreateShader(const std::wstring& filename, int bufferSize) const;
-	ID3D11Buffer* CreateConstantBuffer(int bufferSize) const;
-	ID3D11Buffer* CreateVertexBuffer(const RECT &r, const POINTF &texCoordTopLeft, const POINTF &texCoordBottomRight) const;
+	Shader CreateShader(const std::wstring& filename, int bufferSize);
+	BufferHandle CreateConstantBuffer(int bufferSize);
+	BufferHandle CreateVertexBuffer(const RECT &r, const POINTF &texCoordTopLeft, const POINTF &texCoordBottomRight);
+
+	// Resources are released once the GPU can no longer be using them.
+	void DestroyShader(const Shader& shader);
+
 protected:
 	bool InitMainWindow();
 	bool InitDirect3D();
+	// Returns false, and records StatusInvalidHandle, if any handle is stale.
+	bool BindShader(const Shader& shader, DepthStencilStateHandle depthState);
+	void ExecuteDraws();
+	void CollectResources();
+
+	// DXGI queues at most this many frames ahead of the CPU by default.
+	static const uint64_t FramesInFlight = 3;
+
+	// Each frame submits the two full-screen passes below; a small fixed queue leaves
+	// room for more without allocating megabytes of items and sort scratch.
+	static const size_t DrawQueueCapacity = 16;
+
+	enum PipelineId
+	{
+		RebuildZBufferPipeline,
+		CameraMotionBlurPipeline,
+	};
+
+	enum DrawCommandId
+	{
+		FullScreenQuadDraw,
+	};
 
 protected:
 
@@ -131,10 +202,19 @@ protected:
 	int mClientWidth;
 	int mClientHeight;
 	bool mEnable4xMsaa;
-	ID3D11Buffer* mVB;
-	Shader mShader1, mShader2;
-	ID3D11DepthStencilState* mDS1;
-	ID3D11DepthStencilState* mDS2;
+
+	BufferPool mBuffers;
+	VertexShaderPool mVertexShaders;
+	PixelShaderPool mPixelShaders;
+	InputLayoutPool mInputLayouts;
+	DepthStencilStatePool mDepthStencilStates;
+	uint64_t mFrameIndex;
+
+	DrawQueue mDrawQueue;
+	std::vector<Pipeline> mPipelines;
+	std::vector<DrawCommand> mDrawCommands;
+
+	BufferHandle mVB;
 };
 
 #endif // D3DAPP_H
\ No newline at end of file
@@ -0,0 +1,232 @@
+//***************************************************************************************
+// DrawQueue.cpp
+//***************************************************************************************
+
+#include "DrawQueue.h"
+#include "Status.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const unsigned RadixBits = 8;
+	const unsigned Buckets = 1 << RadixBits;
+	const unsigned Digits = 64 / RadixBits;
+
+	// Below this many items per thread the fork/join overhead outweighs the gain.
+	const size_t MinItemsPerChunk = 16384;
+	const unsigned MaxChunks = 32;
+
+	inline unsigned Digit(uint64_t key, unsigned shift)
+	{
+		return (unsigned)(key >> shift) & (Buckets - 1);
+	}
+
+	// Returns a mask of the key bits that are not the same in every item.
+	uint64_t VaryingBits(const DrawItem* items, size_t begin, size_t end, uint64_t& andKeys, uint64_t& orKeys)
+	{
+		andKeys = ~0ull;
+		orKeys = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			andKeys &= items[i].Key;
+			orKeys |= items[i].Key;
+		}
+		return andKeys ^ orKeys;
+	}
+
+	DrawItem* SortSerial(DrawItem* items, DrawItem* scratch, size_t count)
+	{
+		uint64_t andKeys, orKeys;
+		uint64_t varying = VaryingBits(items, 0, count, andKeys, orKeys);
+
+		// Digits on which all keys agree would be identity passes.
+		unsigned shifts[Digits];
+		unsigned passes = 0;
+		for (unsigned d = 0; d < Digits; ++d)
+		{
+			if (Digit(varying, d * RadixBits) != 0)
+				shifts[passes++] = d * RadixBits;
+		}
+
+		// One read computes the histograms of all remaining digits.
+		uint32_t histograms[Digits][Buckets] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint64_t key = items[i].Key;
+			for (unsigned p = 0; p < passes; ++p)
+			{
+				++histograms[p][Digit(key, shifts[p])];
+			}
+		}
+
+		DrawItem* src = items;
+		DrawItem* dst = scratch;
+		for (unsigned p = 0; p < passes; ++p)
+		{
+			uint32_t* histogram = histograms[p];
+			unsigned shift = shifts[p];
+
+			uint32_t offset = 0;
+			for (unsigned b = 0; b < Buckets; ++b)
+			{
+				uint32_t n = histogram[b];
+				histogram[b] = offset;
+				offset += n;
+			}
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				dst[histogram[Digit(src[i].Key, shift)]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+
+		return src;
+	}
+
+	struct ParallelSort
+	{
+		DrawItem* Src;
+		DrawItem* Dst;
+		size_t Count;
+		size_t ChunkSize;
+		unsigned Chunks;
+		unsigned Shift;
+		uint64_t AndKeys[MaxChunks];
+		uint64_t OrKeys[MaxChunks];
+		uint32_t Offsets[MaxChunks][Buckets];
+
+		size_t Begin(unsigned chunk)const { return std::min(Count, chunk * ChunkSize); }
+		size_t End(unsigned chunk)const { return std::min(Count, (chunk + 1) * ChunkSize); }
+	};
+
+	DrawItem* SortParallel(DrawItem* items, DrawItem* scratch, size_t count, WorkerPool& pool, unsigned chunks)
+	{
+		ParallelSort sort;
+		sort.Src = items;
+		sort.Dst = scratch;
+		sort.Count = count;
+		sort.Chunks = chunks;
+		sort.ChunkSize = (count + chunks - 1) / chunks;
+		sort.Shift = 0;
+
+		// Digits on which all keys agree are found from the AND and OR of every key.
+		auto reduce = [&sort](unsigned chunk)
+		{
+			VaryingBits(sort.Src, sort.Begin(chunk), sort.End(chunk), sort.AndKeys[chunk], sort.OrKeys[chunk]);
+		};
+		pool.ParallelFor(chunks, reduce);
+
+		uint64_t andKeys = ~0ull, orKeys = 0;
+		for (unsigned c = 0; c < chunks; ++c)
+		{
+			andKeys &= sort.AndKeys[c];
+			orKeys |= sort.OrKeys[c];
+		}
+		uint64_t varying = andKeys ^ orKeys;
+
+		auto histogram = [&sort](unsigned chunk)
+		{
+			uint32_t* histogram = sort.Offsets[chunk];
+			memset(histogram, 0, Buckets * sizeof(uint32_t));
+			for (size_t i = sort.Begin(chunk), end = sort.End(chunk); i < end; ++i)
+			{
+				++histogram[Digit(sort.Src[i].Key, sort.Shift)];
+			}
+		};
+
+		auto scatter = [&sort](unsigned chunk)
+		{
+			uint32_t* offsets = sort.Offsets[chunk];
+			for (size_t i = sort.Begin(chunk), end = sort.End(chunk); i < end; ++i)
+			{
+				sort.Dst[offsets[Digit(sort.Src[i].Key, sort.Shift)]++] = sort.Src[i];
+			}
+		};
+
+		for (unsigned d = 0; d < Digits; ++d)
+		{
+			sort.Shift = d * RadixBits;
+			if (Digit(varying, sort.Shift) == 0)
+				continue;
+
+			pool.ParallelFor(chunks, histogram);
+
+			// Bucket-major, chunk-minor prefix sum keeps the sort stable.
+			uint32_t offset = 0;
+			for (unsigned b = 0; b < Buckets; ++b)
+			{
+				for (unsigned c = 0; c < chunks; ++c)
+				{
+					uint32_t n = sort.Offsets[c][b];
+					sort.Offsets[c][b] = offset;
+					offset += n;
+				}
+			}
+
+			pool.ParallelFor(chunks, scatter);
+			std::swap(sort.Src, sort.Dst);
+		}
+
+		return sort.Src;
+	}
+}
+
+DrawItem* RadixSort(DrawItem* items, DrawItem* scratch, size_t count, WorkerPool* pool)
+{
+	if (count < 2)
+		return items;
+
+	unsigned chunks = 1;
+	if (pool)
+	{
+		chunks = (unsigned)std::min<size_t>(count / MinItemsPerChunk, std::min(pool->Concurrency(), MaxChunks));
+	}
+
+	if (chunks <= 1)
+		return SortSerial(items, scratch, count);
+
+	return SortParallel(items, scratch, count, *pool, chunks);
+}
+
+DrawQueue::DrawQueue(size_t capacity) :
+	mItems(capacity),
+	mScratch(capacity)
+{
+}
+
+size_t DrawQueue::Append(const DrawItem* items, size_t count)
+{
+	if (count == 0)
+		return 0;
+
+	size_t start = mCount.fetch_add(count, std::memory_order_relaxed);
+	size_t capacity = mItems.size();
+
+	size_t written = 0;
+	if (start < capacity)
+	{
+		written = std::min(count, capacity - start);
+		memcpy(&mItems[start], items, written * sizeof(DrawItem));
+	}
+
+	if (written != count)
+	{
+		static const SourceLocation location = { __FILE__, "DrawQueue::Append", __LINE__ };
+		GlobalErrorRing().Push(StatusOutOfMemory, &location);
+	}
+
+	return written;
+}
+
+void DrawQueue::Sort(WorkerPool* pool)
+{
+	if (RadixSort(mItems.data(), mScratch.data(), Size(), pool) != mItems.data())
+	{
+		// The sorted run ended up in the scratch buffer; trade buffers instead of copying.
+		mItems.swap(mScratch);
+	}
+}
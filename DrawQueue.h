@@ -0,0 +1,158 @@
+//***************************************************************************************
+// DrawQueue.h
+//
+// Per-frame draw submission.  Every draw is a 64-bit sort key plus a 32-bit payload
+// (typically an index into the caller's draw command array).  Any number of threads
+// may submit concurrently; Sort() then orders the draws with an LSD radix sort so
+// that dispatch visits them pass by pass, pipeline by pipeline.
+//***************************************************************************************
+
+#ifndef DRAWQUEUE_H
+#define DRAWQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Key layout, most significant first:
+//   [63..60] pass      [59..44] pipeline      [43..24] material      [23..0] depth
+namespace DrawKey
+{
+	const uint32_t PassBits = 4;
+	const uint32_t PipelineBits = 16;
+	const uint32_t MaterialBits = 20;
+	const uint32_t DepthBits = 24;
+
+	const uint32_t DepthShift = 0;
+	const uint32_t MaterialShift = DepthShift + DepthBits;
+	const uint32_t PipelineShift = MaterialShift + MaterialBits;
+	const uint32_t PassShift = PipelineShift + PipelineBits;
+
+	inline uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth)
+	{
+		return ((uint64_t)(pass & ((1u << PassBits) - 1)) << PassShift) |
+			((uint64_t)(pipeline & ((1u << PipelineBits) - 1)) << PipelineShift) |
+			((uint64_t)(material & ((1u << MaterialBits) - 1)) << MaterialShift) |
+			((uint64_t)(depth & ((1u << DepthBits) - 1)) << DepthShift);
+	}
+
+	// Maps a depth in [0, 1] to the key's depth field; nearer sorts first.
+	inline uint32_t QuantizeDepth(float depth)
+	{
+		if (!(depth > 0.0f))
+			return 0;
+		if (depth >= 1.0f)
+			return (1u << DepthBits) - 1;
+		return (uint32_t)(depth * (float)((1u << DepthBits) - 1));
+	}
+
+	inline uint32_t Pass(uint64_t key) { return (uint32_t)(key >> PassShift) & ((1u << PassBits) - 1); }
+	inline uint32_t Pipeline(uint64_t key) { return (uint32_t)(key >> PipelineShift) & ((1u << PipelineBits) - 1); }
+	inline uint32_t Material(uint64_t key) { return (uint32_t)(key >> MaterialShift) & ((1u << MaterialBits) - 1); }
+	inline uint32_t Depth(uint64_t key) { return (uint32_t)(key >> DepthShift) & ((1u << DepthBits) - 1); }
+}
+
+struct DrawItem
+{
+	uint64_t Key;
+	uint32_t Payload;
+	uint32_t Reserved;
+};
+
+// Stable LSD radix sort of items by Key, 8 bits per pass.  Passes in which every key
+// has the same digit are skipped.  scratch must hold count items.  Returns whichever
+// of items or scratch holds the result.  Large inputs are split across the pool's
+// threads when one is given.
+DrawItem* RadixSort(DrawItem* items, DrawItem* scratch, size_t count, WorkerPool* pool = nullptr);
+
+class DrawQueue
+{
+public:
+	explicit DrawQueue(size_t capacity);
+
+	DrawQueue(const DrawQueue&) = delete;
+	DrawQueue& operator=(const DrawQueue&) = delete;
+
+	// Starts a new frame.  Not thread-safe with Submit().
+	void Reset()
+	{
+		mCount.store(0, std::memory_order_relaxed);
+	}
+
+	// Thread-safe.  Returns false, and records the overflow in the error ring,
+	// when the queue is full.
+	bool Submit(uint64_t key, uint32_t payload)
+	{
+		DrawItem item = { key, payload, 0 };
+		return Append(&item, 1) == 1;
+	}
+
+	// Batches submissions from one thread so that the shared counter is touched
+	// once per Writer::BatchSize draws instead of once per draw.
+	class Writer
+	{
+	public:
+		static const size_t BatchSize = 128;
+
+		explicit Writer(DrawQueue& queue) :
+			mQueue(queue)
+		{
+		}
+
+		~Writer()
+		{
+			Flush();
+		}
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		void Submit(uint64_t key, uint32_t payload)
+		{
+			if (mCount == BatchSize)
+				Flush();
+
+			mItems[mCount].Key = key;
+			mItems[mCount].Payload = payload;
+			mItems[mCount].Reserved = 0;
+			++mCount;
+		}
+
+		void Flush()
+		{
+			mQueue.Append(mItems, mCount);
+			mCount = 0;
+		}
+
+	private:
+		DrawQueue& mQueue;
+		DrawItem mItems[BatchSize];
+		size_t mCount = 0;
+	};
+
+	// Orders the submitted draws by key.  Call after all writers have flushed.
+	void Sort(WorkerPool* pool = nullptr);
+
+	size_t Size()const
+	{
+		size_t count = mCount.load(std::memory_order_acquire);
+		return count < mItems.size() ? count : mItems.size();
+	}
+
+	size_t Capacity()const { return mItems.size(); }
+
+	const DrawItem* begin()const { return mItems.data(); }
+	const DrawItem* end()const { return mItems.data() + Size(); }
+
+private:
+	size_t Append(const DrawItem* items, size_t count);
+
+	std::vector<DrawItem> mItems;
+	std::vector<DrawItem> mScratch;
+	std::atomic<size_t> mCount{0};
+};
+
+#endif // DRAWQUEUE_H
@@ -0,0 +1,203 @@
+//***************************************************************************************
+// Geometry.cpp
+//***************************************************************************************
+
+#include "Geometry.h"
+#include "CpuFeatures.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float Unorm16Scale = 65535.0f;
+	const float Snorm16Scale = 32767.0f;
+
+	inline uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t magnitude = bits & 0x7FFFFFFF;
+
+		// NaNs stay quiet NaNs and keep the top of their payload, as F16C does.
+		if (magnitude > 0x7F800000)
+			return (uint16_t)(sign | 0x7E00 | ((magnitude >> 13) & 0x3FF));
+		if (magnitude >= 0x47800000)
+			return (uint16_t)(sign | 0x7C00);
+
+		uint32_t half, remainder, halfway;
+		if (magnitude < 0x38800000)
+		{
+			// Below the smallest normal half: shift the full mantissa into 2^-24 units.
+			if (magnitude < 0x33000000)
+				return (uint16_t)sign;
+			uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+			uint32_t shift = 126 - (magnitude >> 23);
+			half = mantissa >> shift;
+			remainder = mantissa & ((1u << shift) - 1);
+			halfway = 1u << (shift - 1);
+		}
+		else
+		{
+			half = (magnitude - 0x38000000) >> 13;
+			remainder = magnitude & 0x1FFF;
+			halfway = 0x1000;
+		}
+
+		// Round to nearest even; a carry correctly moves into the exponent.
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			++half;
+		return (uint16_t)(sign | half);
+	}
+
+	inline float HalfToFloat(uint16_t value)
+	{
+		uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+		uint32_t exponent = (value >> 10) & 0x1F;
+		uint32_t mantissa = value & 0x3FF;
+
+		if (exponent == 0)
+		{
+			float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+			return sign ? -magnitude : magnitude;
+		}
+
+		uint32_t bits = sign | (exponent == 31 ? 0x7F800000 | (mantissa ? 0x400000 : 0) : (exponent + 112) << 23) | (mantissa << 13);
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	// NaN converts to 0.
+	inline int16_t ToSnorm16(float value)
+	{
+		return value == value ? (int16_t)std::lrint(std::min(std::max(value, -1.0f), 1.0f) * Snorm16Scale) : 0;
+	}
+
+	inline uint16_t ToUnorm16(float value)
+	{
+		return value == value ? (uint16_t)std::lrint(std::min(std::max(value, 0.0f), 1.0f) * Unorm16Scale) : 0;
+	}
+
+	inline void PackUnorm16x2(const float* value, uint16_t* result)
+	{
+		for (int i = 0; i < 2; ++i)
+			result[i] = ToUnorm16(value[i]);
+	}
+
+	inline void UnpackUnorm16x2(const uint16_t* value, float* result)
+	{
+		for (int i = 0; i < 2; ++i)
+			result[i] = (float)value[i] * (1.0f / Unorm16Scale);
+	}
+
+	inline void SetVertex(VertexPositionTexture& vertex, float x, float y, float u, float v)
+	{
+		vertex.Position[0] = x;
+		vertex.Position[1] = y;
+		vertex.Position[2] = 0;
+		vertex.Position[3] = 1;
+		vertex.TexCoord[0] = u;
+		vertex.TexCoord[1] = v;
+	}
+}
+
+void BuildQuad(const QuadRect& rect, float u0, float v0, float u1, float v1, VertexPositionTexture* vertices)
+{
+	SetVertex(vertices[0], rect.Left, rect.Top, u0, v0);
+	SetVertex(vertices[1], rect.Right, rect.Top, u1, v0);
+	SetVertex(vertices[2], rect.Left, rect.Bottom, u0, v1);
+	SetVertex(vertices[3], rect.Right, rect.Bottom, u1, v1);
+}
+
+void BuildQuads(const QuadRect* rects, size_t count, float u0, float v0, float u1, float v1, VertexPositionTexture* vertices)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		BuildQuad(rects[i], u0, v0, u1, v1, vertices + 4 * i);
+	}
+}
+
+void PackVertices(const VertexPositionTexture* input, size_t count, VertexPositionTextureHalf* output)
+{
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		PackVerticesAvx2(input, count, output);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexPositionTextureHalf& out = output[i];
+		for (int c = 0; c < 4; ++c)
+			out.Position[c] = FloatToHalf(in.Position[c]);
+		PackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void PackVertices(const VertexPositionTexture* input, size_t count, VertexPositionTextureSnorm* output)
+{
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		PackVerticesAvx2(input, count, output);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexPositionTextureSnorm& out = output[i];
+		for (int c = 0; c < 4; ++c)
+			out.Position[c] = ToSnorm16(in.Position[c]);
+		PackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void UnpackVertices(const VertexPositionTextureHalf* input, size_t count, VertexPositionTexture* output)
+{
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		UnpackVerticesAvx2(input, count, output);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTextureHalf& in = input[i];
+		VertexPositionTexture& out = output[i];
+		for (int c = 0; c < 4; ++c)
+			out.Position[c] = HalfToFloat(in.Position[c]);
+		UnpackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void UnpackVertices(const VertexPositionTextureSnorm* input, size_t count, VertexPositionTexture* output)
+{
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		UnpackVerticesAvx2(input, count, output);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTextureSnorm& in = input[i];
+		VertexPositionTexture& out = output[i];
+		// -32768 and -32767 both map to -1.
+		for (int c = 0; c < 4; ++c)
+			out.Position[c] = std::max((float)in.Position[c] * (1.0f / Snorm16Scale), -1.0f);
+		UnpackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
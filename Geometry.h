@@ -0,0 +1,84 @@
+//***************************************************************************************
+// Geometry.h
+//
+// Vertex formats and quad generation shared by the D3D11 app and the CPU backend.
+//***************************************************************************************
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct VertexPositionTexture
+{
+	typedef VertexLayout<
+		VertexElement<VertexFloat4, VertexSemanticPosition>,
+		VertexElement<VertexFloat2, VertexSemanticTexCoord>> Layout;
+
+	float Position[4];
+	float TexCoord[2];
+};
+
+CheckVertexElement(VertexPositionTexture, 0, Position);
+CheckVertexElement(VertexPositionTexture, 1, TexCoord);
+static_assert(sizeof(VertexPositionTexture) == VertexPositionTexture::Layout::Stride, "VertexPositionTexture must match its layout.");
+
+// 12-byte form of VertexPositionTexture: half-float position, UNORM16 texture
+// coordinates.  Halves are exact for integer pixel positions up to 2048; texture
+// coordinates are clamped to [0, 1].
+struct VertexPositionTextureHalf
+{
+	typedef VertexLayout<
+		VertexElement<VertexHalf4, VertexSemanticPosition>,
+		VertexElement<VertexUnorm16x2, VertexSemanticTexCoord>> Layout;
+
+	uint16_t Position[4];
+	uint16_t TexCoord[2];
+};
+
+CheckVertexElement(VertexPositionTextureHalf, 0, Position);
+CheckVertexElement(VertexPositionTextureHalf, 1, TexCoord);
+static_assert(sizeof(VertexPositionTextureHalf) == VertexPositionTextureHalf::Layout::Stride, "VertexPositionTextureHalf must match its layout.");
+
+// 12-byte form for geometry already in [-1, 1] (clip or normalized space): SNORM16
+// position, UNORM16 texture coordinates.  Positions outside the range are clamped.
+struct VertexPositionTextureSnorm
+{
+	typedef VertexLayout<
+		VertexElement<VertexSnorm16x4, VertexSemanticPosition>,
+		VertexElement<VertexUnorm16x2, VertexSemanticTexCoord>> Layout;
+
+	int16_t Position[4];
+	uint16_t TexCoord[2];
+};
+
+CheckVertexElement(VertexPositionTextureSnorm, 0, Position);
+CheckVertexElement(VertexPositionTextureSnorm, 1, TexCoord);
+static_assert(sizeof(VertexPositionTextureSnorm) == VertexPositionTextureSnorm::Layout::Stride, "VertexPositionTextureSnorm must match its layout.");
+
+struct QuadRect
+{
+	float Left;
+	float Top;
+	float Right;
+	float Bottom;
+};
+
+// Writes a four-vertex triangle strip (top left, top right, bottom left, bottom right)
+// covering rect, with texture coordinates spanning (u0, v0) to (u1, v1).
+void BuildQuad(const QuadRect& rect, float u0, float v0, float u1, float v1, VertexPositionTexture* vertices);
+
+// BuildQuad for count rectangles; writes 4 * count vertices.
+void BuildQuads(const QuadRect* rects, size_t count, float u0, float v0, float u1, float v1, VertexPositionTexture* vertices);
+
+// Conversions between the full and the compact vertex formats, rounding to nearest
+// like the D3D float -> HALF/SNORM/UNORM rules.
+void PackVertices(const VertexPositionTexture* input, size_t count, VertexPositionTextureHalf* output);
+void PackVertices(const VertexPositionTexture* input, size_t count, VertexPositionTextureSnorm* output);
+void UnpackVertices(const VertexPositionTextureHalf* input, size_t count, VertexPositionTexture* output);
+void UnpackVertices(const VertexPositionTextureSnorm* input, size_t count, VertexPositionTexture* output);
+
+#endif // GEOMETRY_H
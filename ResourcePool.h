@@ -0,0 +1,223 @@
+//***************************************************************************************
+// ResourcePool.h
+//
+// Dense slot map addressed by 32-bit generational handles.  Values are stored
+// contiguously; a handle is validated with one index compare and one generation
+// compare, and looking a value up never touches a reference count.  Destroy() only
+// retires the value: it is handed to the deleter once the caller reports that the
+// backend has finished the frame it was last used in.
+//***************************************************************************************
+
+#ifndef RESOURCEPOOL_H
+#define RESOURCEPOOL_H
+
+#include "Status.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Low IndexBits select the slot, the high bits hold the slot generation.
+// Generation 0 is never issued, so a zero handle is always invalid.
+template<typename T>
+struct Handle
+{
+	static const uint32_t IndexBits = 20;
+	static const uint32_t IndexMask = (1u << IndexBits) - 1;
+	static const uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+	uint32_t Value = 0;
+
+	Handle() = default;
+	Handle(uint32_t index, uint32_t generation) :
+		Value((generation << IndexBits) | index)
+	{
+	}
+
+	uint32_t Index()const { return Value & IndexMask; }
+	uint32_t Generation()const { return Value >> IndexBits; }
+	bool IsNull()const { return Value == 0; }
+
+	bool operator==(Handle other)const { return Value == other.Value; }
+	bool operator!=(Handle other)const { return Value != other.Value; }
+};
+
+template<typename T, typename Deleter>
+class ResourcePool
+{
+public:
+	typedef Handle<T> HandleType;
+
+	static const uint32_t MaxSize = HandleType::IndexMask + 1;
+
+	ResourcePool() = default;
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	~ResourcePool()
+	{
+		DestroyAll();
+	}
+
+	void Reserve(size_t count)
+	{
+		mSlots.reserve(count);
+		mDense.reserve(count);
+		mDenseToSlot.reserve(count);
+	}
+
+	// Once all MaxSize slots are live the value is handed straight to the deleter,
+	// StatusOutOfMemory is recorded and a null handle is returned.
+	HandleType Create(T value)
+	{
+		uint32_t index;
+		if (mFreeHead != NoSlot)
+		{
+			index = mFreeHead;
+			mFreeHead = mSlots[index].Next;
+		}
+		else if (mSlots.size() < MaxSize)
+		{
+			index = (uint32_t)mSlots.size();
+			mSlots.push_back(Slot());
+		}
+		else
+		{
+			static const SourceLocation location = { __FILE__, "ResourcePool::Create", __LINE__ };
+			GlobalErrorRing().Push(StatusOutOfMemory, &location);
+			mDeleter(value);
+			return HandleType();
+		}
+
+		Slot& slot = mSlots[index];
+		slot.Next = (uint32_t)mDense.size();
+		mDense.push_back(std::move(value));
+		mDenseToSlot.push_back(index);
+
+		return HandleType(index, slot.Generation);
+	}
+
+	bool IsValid(HandleType handle)const
+	{
+		uint32_t index = handle.Index();
+		return index < mSlots.size() && mSlots[index].Generation == handle.Generation();
+	}
+
+	// Returns nullptr for null or stale handles.
+	T* Get(HandleType handle)
+	{
+		return IsValid(handle) ? &mDense[mSlots[handle.Index()].Next] : nullptr;
+	}
+
+	const T* Get(HandleType handle)const
+	{
+		return IsValid(handle) ? &mDense[mSlots[handle.Index()].Next] : nullptr;
+	}
+
+	// Invalidates the handle immediately and defers the deleter until
+	// Collect() is called with a completed fence >= fence.
+	void Destroy(HandleType handle, uint64_t fence)
+	{
+		if (!IsValid(handle))
+			return;
+
+		uint32_t index = handle.Index();
+		Slot& slot = mSlots[index];
+		uint32_t dense = slot.Next;
+
+		mRetired.push_back(Retired{ std::move(mDense[dense]), fence });
+
+		// Keep the dense array packed by moving the last value into the hole.
+		uint32_t last = (uint32_t)mDense.size() - 1;
+		if (dense != last)
+		{
+			mDense[dense] = std::move(mDense[last]);
+			mDenseToSlot[dense] = mDenseToSlot[last];
+			mSlots[mDenseToSlot[dense]].Next = dense;
+		}
+		mDense.pop_back();
+		mDenseToSlot.pop_back();
+
+		Free(index);
+	}
+
+	// Deletes every retired value whose fence has completed.
+	void Collect(uint64_t completedFence)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < mRetired.size(); ++i)
+		{
+			if (mRetired[i].Fence <= completedFence)
+			{
+				mDeleter(mRetired[i].Value);
+			}
+			else
+			{
+				if (kept != i)
+					mRetired[kept] = std::move(mRetired[i]);
+				++kept;
+			}
+		}
+		mRetired.erase(mRetired.begin() + kept, mRetired.end());
+	}
+
+	// Deletes live and retired values right away.  The caller guarantees that
+	// the backend is idle.
+	void DestroyAll()
+	{
+		for (size_t i = 0; i < mRetired.size(); ++i)
+			mDeleter(mRetired[i].Value);
+		for (size_t i = 0; i < mDense.size(); ++i)
+		{
+			mDeleter(mDense[i]);
+			Free(mDenseToSlot[i]);
+		}
+
+		mRetired.clear();
+		mDense.clear();
+		mDenseToSlot.clear();
+	}
+
+	size_t Size()const { return mDense.size(); }
+	size_t RetiredSize()const { return mRetired.size(); }
+
+	// Dense iteration over live values.
+	T* begin() { return mDense.data(); }
+	T* end() { return mDense.data() + mDense.size(); }
+
+private:
+	static const uint32_t NoSlot = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		uint32_t Generation = 1;
+		uint32_t Next = NoSlot;		// Dense index while live, next free slot otherwise.
+	};
+
+	struct Retired
+	{
+		T Value;
+		uint64_t Fence;
+	};
+
+	// Bumps the generation so outstanding handles go stale, then links the slot into the free list.
+	void Free(uint32_t index)
+	{
+		Slot& slot = mSlots[index];
+		slot.Generation = (slot.Generation + 1) & HandleType::GenerationMask;
+		if (slot.Generation == 0)
+			slot.Generation = 1;
+		slot.Next = mFreeHead;
+		mFreeHead = index;
+	}
+
+	std::vector<Slot> mSlots;
+	std::vector<T> mDense;
+	std::vector<uint32_t> mDenseToSlot;
+	std::vector<Retired> mRetired;
+	uint32_t mFreeHead = NoSlot;
+	Deleter mDeleter;
+};
+
+#endif // RESOURCEPOOL_H
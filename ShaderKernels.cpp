@@ -0,0 +1,89 @@
+//***************************************************************************************
+// ShaderKernels.cpp
+//***************************************************************************************
+
+#include "ShaderKernels.h"
+#include "ConstantBuffers.h"
+
+#include <algorithm>
+
+namespace
+{
+	inline uint32_t ToUnorm8(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return (uint32_t)(value * 255.0f + 0.5f);
+	}
+
+	inline void Fill(uint32_t* colors, int count, uint32_t color)
+	{
+		std::fill(colors, colors + count, color);
+	}
+}
+
+uint32_t PackR8G8B8A8(const float color[4])
+{
+	return ToUnorm8(color[0]) | (ToUnorm8(color[1]) << 8) | (ToUnorm8(color[2]) << 16) | (ToUnorm8(color[3]) << 24);
+}
+
+void RebuildZBufferVS(const void*, const VertexPositionTexture* input, VertexOutput* output, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexOutput& out = output[i];
+
+		out.Position[0] = in.Position[0];
+		out.Position[1] = in.Position[1];
+		out.Position[2] = in.Position[2];
+		out.Position[3] = in.Position[3];
+		out.TexCoord[0] = in.TexCoord[0];
+		out.TexCoord[1] = in.TexCoord[1];
+		out.FrustumRay[0] = out.FrustumRay[1] = out.FrustumRay[2] = 0;
+	}
+}
+
+void RebuildZBufferPS(const void* constants, const PixelSpan& span, uint32_t* colors)
+{
+	// return Color;
+	const RebuildZBufferConstants& c = *static_cast<const RebuildZBufferConstants*>(constants);
+	Fill(colors, span.Count, PackR8G8B8A8(c.Color));
+}
+
+void CameraMotionBlurVS(const void* constants, const VertexPositionTexture* input, VertexOutput* output, size_t count)
+{
+	const CameraMotionBlurConstants& c = *static_cast<const CameraMotionBlurConstants*>(constants);
+
+	// The effect hard-codes the viewport size.
+	const float viewportWidth = 1600, viewportHeight = 900;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexOutput& out = output[i];
+
+		float x = in.Position[0] / viewportWidth;
+		float y = in.Position[1] / viewportHeight;
+
+		out.TexCoord[0] = x;
+		out.TexCoord[1] = y;
+		out.Position[0] = x * 2 - 1;
+		out.Position[1] = y * -2 + 1;
+		out.Position[2] = in.Position[2];
+		out.Position[3] = in.Position[3];
+
+		// int index = (int) clamp(GetCornerIndex(input.TexCoord), 0, 3);
+		float corner = in.TexCoord[0] + in.TexCoord[1] * 2;
+		int index = (int)std::min(std::max(corner, 0.0f), 3.0f);
+		out.FrustumRay[0] = c.FrustumCorners[index].X;
+		out.FrustumRay[1] = c.FrustumCorners[index].Y;
+		out.FrustumRay[2] = c.FrustumCorners[index].Z;
+	}
+}
+
+void CameraMotionBlurPS(const void*, const PixelSpan& span, uint32_t* colors)
+{
+	// return float4(0, 1, 0.5, 1);
+	static const float color[4] = { 0, 1, 0.5f, 1 };
+	Fill(colors, span.Count, PackR8G8B8A8(color));
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// ShaderKernels.h
+//
+// CPU equivalents of the VS/PS entry points in RebuildZBuffer.fx and
+// CameraMotionBlur.fx.  Vertex kernels transform a batch of vertices; pixel kernels
+// shade a horizontal span and write R8G8B8A8_UNORM texels.
+//***************************************************************************************
+
+#ifndef SHADERKERNELS_H
+#define SHADERKERNELS_H
+
+#include "Geometry.h"
+#include "Texture.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Union of the VS outputs of both effects.
+struct VertexOutput
+{
+	float Position[4];
+	float TexCoord[2];
+	float FrustumRay[3];
+};
+
+// Number of texture slots a pixel kernel can read from.
+const int PixelTextureSlots = 2;
+
+// A run of covered pixels on one row.  Interpolants are given at the centre of the
+// first pixel together with their per-pixel step along x.
+struct PixelSpan
+{
+	const Texture* const* Textures;
+	int X;
+	int Y;
+	int Count;
+	float TexCoord[2];
+	float TexCoordDx[2];
+	float FrustumRay[3];
+	float FrustumRayDx[3];
+};
+
+typedef void (*VertexKernel)(const void* constants, const VertexPositionTexture* input, VertexOutput* output, size_t count);
+typedef void (*PixelKernel)(const void* constants, const PixelSpan& span, uint32_t* colors);
+
+// Rounds to nearest like the D3D float -> UNORM conversion.
+uint32_t PackR8G8B8A8(const float color[4]);
+
+void RebuildZBufferVS(const void* constants, const VertexPositionTexture* input, VertexOutput* output, size_t count);
+void RebuildZBufferPS(const void* constants, const PixelSpan& span, uint32_t* colors);
+
+void CameraMotionBlurVS(const void* constants, const VertexPositionTexture* input, VertexOutput* output, size_t count);
+void CameraMotionBlurPS(const void* constants, const PixelSpan& span, uint32_t* colors);
+
+#endif // SHADERKERNELS_H
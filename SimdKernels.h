@@ -0,0 +1,38 @@
+//***************************************************************************************
+// SimdKernels.h
+//
+// AVX2 versions of the Texture sampling and vertex packing kernels.  They are only
+// built when DXCRASH_HAVE_AVX2 is defined and must only be called when
+// ActiveSimdLevel() is SimdLevelAvx2; Texture and the Geometry functions dispatch to
+// them, and their scalar code is the reference the results are checked against.
+//***************************************************************************************
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include "Geometry.h"
+#include "Texture.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// One mip level as the sampling kernels see it.
+struct TextureLevelView
+{
+	const uint32_t* Texels;
+	int Width;
+	int Height;
+	int Pitch;			// Texels (linear), tiles (tiled) or blocks (swizzled) per row.
+	TextureLayout Layout;
+	TextureFormat Format;
+};
+
+void SamplePoint8Avx2(const TextureLevelView& level, const float* u, const float* v, uint32_t* texels);
+void SampleBilinear8Avx2(const TextureLevelView& level, const float* u, const float* v, Color8& color);
+
+void PackVerticesAvx2(const VertexPositionTexture* input, size_t count, VertexPositionTextureHalf* output);
+void PackVerticesAvx2(const VertexPositionTexture* input, size_t count, VertexPositionTextureSnorm* output);
+void UnpackVerticesAvx2(const VertexPositionTextureHalf* input, size_t count, VertexPositionTexture* output);
+void UnpackVerticesAvx2(const VertexPositionTextureSnorm* input, size_t count, VertexPositionTexture* output);
+
+#endif // SIMDKERNELS_H
@@ -0,0 +1,238 @@
+//***************************************************************************************
+// SimdKernelsAvx2.cpp
+//
+// The only translation unit built with AVX2/F16C/FMA code generation.  Callers reach
+// these kernels through ActiveSimdLevel(), so the rest of the core runs on any x86-64.
+// Keep it free of calls to inline or template functions shared with other translation
+// units: the linker may keep this file's AVX2 copy of such a function for everyone.
+//***************************************************************************************
+
+#include "SimdKernels.h"
+
+#if defined(DXCRASH_HAVE_AVX2)
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+	const uint32_t DepthMask = 0xFFFFFF;
+	const float DepthScale = 1.0f / (float)DepthMask;
+	const float UnormScale = 1.0f / 255.0f;
+	const float Unorm16Scale = 65535.0f;
+	const float Snorm16Scale = 32767.0f;
+
+	struct LevelVectors
+	{
+		__m256i Pitch;
+		__m256i MaxX;
+		__m256i MaxY;
+		__m256 Width;
+		__m256 Height;
+	};
+
+	inline __m256i TexelAddresses(TextureLayout layout, const LevelVectors& level, __m256i x, __m256i y)
+	{
+		if (layout == TextureLayoutLinear)
+			return _mm256_add_epi32(_mm256_mullo_epi32(y, level.Pitch), x);
+
+		__m256i tx = _mm256_srli_epi32(x, Texture::TileShift);
+		__m256i ty = _mm256_srli_epi32(y, Texture::TileShift);
+		__m256i tile;
+		if (layout == TextureLayoutTiled)
+		{
+			tile = _mm256_add_epi32(_mm256_mullo_epi32(ty, level.Pitch), tx);
+		}
+		else
+		{
+			__m256i block = _mm256_add_epi32(
+				_mm256_mullo_epi32(_mm256_srli_epi32(ty, Texture::BlockShift), level.Pitch),
+				_mm256_srli_epi32(tx, Texture::BlockShift));
+
+			// The permute only reads the low three bits of each lane, which are exactly the
+			// tile's position in its block, so spreading them is one table lookup per axis.
+			const __m256i spread = _mm256_setr_epi32(0, 1, 4, 5, 16, 17, 20, 21);
+			__m256i morton = _mm256_or_si256(
+				_mm256_permutevar8x32_epi32(spread, tx),
+				_mm256_slli_epi32(_mm256_permutevar8x32_epi32(spread, ty), 1));
+			tile = _mm256_or_si256(_mm256_slli_epi32(block, 2 * Texture::BlockShift), morton);
+		}
+
+		const __m256i inTile = _mm256_set1_epi32(Texture::TileSize - 1);
+		__m256i texel = _mm256_or_si256(
+			_mm256_slli_epi32(_mm256_and_si256(y, inTile), Texture::TileShift),
+			_mm256_and_si256(x, inTile));
+		return _mm256_or_si256(_mm256_slli_epi32(tile, 2 * Texture::TileShift), texel);
+	}
+
+	inline __m256i ClampInt(__m256i value, __m256i high)
+	{
+		return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), high);
+	}
+
+	struct Color8Vectors
+	{
+		__m256 R, G, B, A;
+	};
+
+	inline Color8Vectors Decode(TextureFormat format, __m256i texels)
+	{
+		Color8Vectors color;
+		if (format == TextureFormatD24UnormS8Uint)
+		{
+			color.R = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, _mm256_set1_epi32((int)DepthMask))), _mm256_set1_ps(DepthScale));
+			color.G = _mm256_setzero_ps();
+			color.B = _mm256_setzero_ps();
+			color.A = _mm256_set1_ps(1.0f);
+			return color;
+		}
+
+		const __m256i byteMask = _mm256_set1_epi32(255);
+		const __m256 scale = _mm256_set1_ps(UnormScale);
+		color.R = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, byteMask)), scale);
+		color.G = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), byteMask)), scale);
+		color.B = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), byteMask)), scale);
+		color.A = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24)), scale);
+		return color;
+	}
+
+	inline __m256 Lerp(__m256 a, __m256 b, __m256 t)
+	{
+		return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+	}
+
+	inline void Store(const Color8Vectors& color, Color8& result)
+	{
+		_mm256_storeu_ps(result.R, color.R);
+		_mm256_storeu_ps(result.G, color.G);
+		_mm256_storeu_ps(result.B, color.B);
+		_mm256_storeu_ps(result.A, color.A);
+	}
+
+	inline void PackUnorm16x2(const float* value, uint16_t* result)
+	{
+		__m128 v = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(value)));
+		v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		__m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(Unorm16Scale)));
+		int bits = _mm_cvtsi128_si32(_mm_packus_epi32(i, i));
+		memcpy(result, &bits, sizeof(bits));
+	}
+
+	inline void UnpackUnorm16x2(const uint16_t* value, float* result)
+	{
+		int bits;
+		memcpy(&bits, value, sizeof(bits));
+		__m128 v = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_cvtsi32_si128(bits)));
+		_mm_storel_pi(reinterpret_cast<__m64*>(result), _mm_mul_ps(v, _mm_set1_ps(1.0f / Unorm16Scale)));
+	}
+}
+
+void SamplePoint8Avx2(const TextureLevelView& level, const float* u, const float* v, uint32_t* texels)
+{
+	LevelVectors lv;
+	lv.Pitch = _mm256_set1_epi32(level.Pitch);
+	lv.MaxX = _mm256_set1_epi32(level.Width - 1);
+	lv.MaxY = _mm256_set1_epi32(level.Height - 1);
+
+	// Clamping first keeps the float -> int conversion in range.
+	__m256 fx = _mm256_mul_ps(_mm256_loadu_ps(u), _mm256_set1_ps((float)level.Width));
+	__m256 fy = _mm256_mul_ps(_mm256_loadu_ps(v), _mm256_set1_ps((float)level.Height));
+	// maxps returns its second operand when either is NaN, so NaN clamps to -1.
+	fx = _mm256_min_ps(_mm256_max_ps(fx, _mm256_set1_ps(-1.0f)), _mm256_set1_ps((float)level.Width));
+	fy = _mm256_min_ps(_mm256_max_ps(fy, _mm256_set1_ps(-1.0f)), _mm256_set1_ps((float)level.Height));
+	__m256i x = ClampInt(_mm256_cvttps_epi32(_mm256_floor_ps(fx)), lv.MaxX);
+	__m256i y = ClampInt(_mm256_cvttps_epi32(_mm256_floor_ps(fy)), lv.MaxY);
+	__m256i result = _mm256_i32gather_epi32((const int*)level.Texels, TexelAddresses(level.Layout, lv, x, y), 4);
+	_mm256_storeu_si256((__m256i*)texels, result);
+}
+
+void SampleBilinear8Avx2(const TextureLevelView& level, const float* u, const float* v, Color8& color)
+{
+	LevelVectors lv;
+	lv.Pitch = _mm256_set1_epi32(level.Pitch);
+	lv.MaxX = _mm256_set1_epi32(level.Width - 1);
+	lv.MaxY = _mm256_set1_epi32(level.Height - 1);
+
+	// Texel centres sit at (i + 0.5) / size.
+	const __m256 half = _mm256_set1_ps(0.5f);
+	// Clamping first keeps the float -> int conversion in range.
+	__m256 fx = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(u), _mm256_set1_ps((float)level.Width)), half);
+	__m256 fy = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v), _mm256_set1_ps((float)level.Height)), half);
+	// maxps returns its second operand when either is NaN, so NaN clamps to -1.
+	fx = _mm256_min_ps(_mm256_max_ps(fx, _mm256_set1_ps(-1.0f)), _mm256_set1_ps((float)level.Width));
+	fy = _mm256_min_ps(_mm256_max_ps(fy, _mm256_set1_ps(-1.0f)), _mm256_set1_ps((float)level.Height));
+	__m256 floorX = _mm256_floor_ps(fx), floorY = _mm256_floor_ps(fy);
+	__m256 tx = _mm256_sub_ps(fx, floorX), ty = _mm256_sub_ps(fy, floorY);
+
+	__m256i x0 = _mm256_cvttps_epi32(floorX), y0 = _mm256_cvttps_epi32(floorY);
+	__m256i x1 = ClampInt(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), lv.MaxX);
+	__m256i y1 = ClampInt(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), lv.MaxY);
+	x0 = ClampInt(x0, lv.MaxX);
+	y0 = ClampInt(y0, lv.MaxY);
+
+	const int* texels = (const int*)level.Texels;
+	Color8Vectors c00 = Decode(level.Format, _mm256_i32gather_epi32(texels, TexelAddresses(level.Layout, lv, x0, y0), 4));
+	Color8Vectors c10 = Decode(level.Format, _mm256_i32gather_epi32(texels, TexelAddresses(level.Layout, lv, x1, y0), 4));
+	Color8Vectors c01 = Decode(level.Format, _mm256_i32gather_epi32(texels, TexelAddresses(level.Layout, lv, x0, y1), 4));
+	Color8Vectors c11 = Decode(level.Format, _mm256_i32gather_epi32(texels, TexelAddresses(level.Layout, lv, x1, y1), 4));
+
+	Color8Vectors result;
+	result.R = Lerp(Lerp(c00.R, c10.R, tx), Lerp(c01.R, c11.R, tx), ty);
+	result.G = Lerp(Lerp(c00.G, c10.G, tx), Lerp(c01.G, c11.G, tx), ty);
+	result.B = Lerp(Lerp(c00.B, c10.B, tx), Lerp(c01.B, c11.B, tx), ty);
+	result.A = Lerp(Lerp(c00.A, c10.A, tx), Lerp(c01.A, c11.A, tx), ty);
+	Store(result, color);
+}
+
+void PackVerticesAvx2(const VertexPositionTexture* input, size_t count, VertexPositionTextureHalf* output)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexPositionTextureHalf& out = output[i];
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out.Position), _mm_cvtps_ph(_mm_loadu_ps(in.Position), _MM_FROUND_TO_NEAREST_INT));
+		PackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void PackVerticesAvx2(const VertexPositionTexture* input, size_t count, VertexPositionTextureSnorm* output)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTexture& in = input[i];
+		VertexPositionTextureSnorm& out = output[i];
+		// The ordered compare zeroes NaNs before the clamp.
+		__m128 position = _mm_loadu_ps(in.Position);
+		position = _mm_and_ps(position, _mm_cmpord_ps(position, position));
+		position = _mm_min_ps(_mm_max_ps(position, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+		__m128i snorm = _mm_cvtps_epi32(_mm_mul_ps(position, _mm_set1_ps(Snorm16Scale)));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out.Position), _mm_packs_epi32(snorm, snorm));
+		PackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void UnpackVerticesAvx2(const VertexPositionTextureHalf* input, size_t count, VertexPositionTexture* output)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTextureHalf& in = input[i];
+		VertexPositionTexture& out = output[i];
+		_mm_storeu_ps(out.Position, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in.Position))));
+		UnpackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+void UnpackVerticesAvx2(const VertexPositionTextureSnorm* input, size_t count, VertexPositionTexture* output)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionTextureSnorm& in = input[i];
+		VertexPositionTexture& out = output[i];
+		// -32768 and -32767 both map to -1.
+		__m128 position = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in.Position))));
+		_mm_storeu_ps(out.Position, _mm_max_ps(_mm_mul_ps(position, _mm_set1_ps(1.0f / Snorm16Scale)), _mm_set1_ps(-1.0f)));
+		UnpackUnorm16x2(in.TexCoord, out.TexCoord);
+	}
+}
+
+#endif // DXCRASH_HAVE_AVX2
@@ -0,0 +1,187 @@
+//***************************************************************************************
+// Status.h
+//
+// Allocation-free status checking.  The success path of ThrowIfFailedAs/LogIfFailed
+// only compares the code against zero; the source location is a constant-initialized
+// static, and the message is formatted lazily when somebody actually asks for it.
+// Non-fatal failures are pushed into a bounded lock-free ring instead of throwing.
+//***************************************************************************************
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// E_OUTOFMEMORY, for fixed-capacity containers that overflow.
+const int32_t StatusOutOfMemory = (int32_t)0x8007000E;
+
+// E_HANDLE, for lookups through null or stale handles.
+const int32_t StatusInvalidHandle = (int32_t)0x80070006;
+
+// Where a checked expression lives in the source.  Always has static storage duration.
+struct SourceLocation
+{
+	const char* File;
+	const char* Expression;
+	int Line;
+};
+
+// Portable exception carrying an HRESULT-style code (negative means failure).
+class StatusException
+{
+public:
+	StatusException(int32_t code, const SourceLocation& location) :
+		ErrorCode(code),
+		Location(&location)
+	{
+	}
+
+	std::string ToString()const
+	{
+		char code[16];
+		snprintf(code, sizeof(code), "0x%08X", (unsigned)ErrorCode);
+
+		return std::string(Location->Expression) + " failed in " + Location->File + "; line " +
+			std::to_string(Location->Line) + "; error: " + code;
+	}
+
+	int32_t ErrorCode = 0;
+	const SourceLocation* Location = nullptr;
+};
+
+struct ErrorRecord
+{
+	int32_t Code;
+	const SourceLocation* Location;
+};
+
+// Bounded multi-producer/multi-consumer ring (D. Vyukov's sequence-per-cell scheme).
+// Push never blocks; if the ring is full the record is dropped and counted.
+class ErrorRing
+{
+public:
+	static const size_t Capacity = 256;
+
+	ErrorRing()
+	{
+		for (size_t i = 0; i < Capacity; ++i)
+		{
+			mCells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	ErrorRing(const ErrorRing&) = delete;
+	ErrorRing& operator=(const ErrorRing&) = delete;
+
+	bool Push(int32_t code, const SourceLocation* location)
+	{
+		size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = mCells[pos & (Capacity - 1)];
+			size_t seq = cell.Sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.Record.Code = code;
+					cell.Record.Location = location;
+					cell.Sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				mDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				pos = mEnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool Pop(ErrorRecord& record)
+	{
+		size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = mCells[pos & (Capacity - 1)];
+			size_t seq = cell.Sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					record = cell.Record;
+					cell.Sequence.store(pos + Capacity, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = mDequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Number of records lost because the ring was full.
+	size_t Dropped()const
+	{
+		return mDropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+	struct Cell
+	{
+		std::atomic<size_t> Sequence;
+		ErrorRecord Record;
+	};
+
+	Cell mCells[Capacity];
+	alignas(64) std::atomic<size_t> mEnqueuePos{0};
+	alignas(64) std::atomic<size_t> mDequeuePos{0};
+	std::atomic<size_t> mDropped{0};
+};
+
+inline ErrorRing& GlobalErrorRing()
+{
+	static ErrorRing ring;
+	return ring;
+}
+
+// Throws ExceptionType(code, location) if x evaluates to a failure code.
+#define ThrowIfFailedAs(ExceptionType, x)                                        \
+{                                                                                \
+    int32_t hr__ = (int32_t)(x);                                                 \
+    if(hr__ < 0)                                                                 \
+    {                                                                            \
+        static const SourceLocation loc__ = { __FILE__, #x, __LINE__ };          \
+        throw ExceptionType(hr__, loc__);                                        \
+    }                                                                            \
+}
+
+// Records a failure in the global error ring and carries on.
+#define LogIfFailed(x)                                                           \
+{                                                                                \
+    int32_t hr__ = (int32_t)(x);                                                 \
+    if(hr__ < 0)                                                                 \
+    {                                                                            \
+        static const SourceLocation loc__ = { __FILE__, #x, __LINE__ };          \
+        GlobalErrorRing().Push(hr__, &loc__);                                    \
+    }                                                                            \
+}
+
+#endif // STATUS_H
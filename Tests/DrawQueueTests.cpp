@@ -0,0 +1,59 @@
+//***************************************************************************************
+// DrawQueueTests.cpp
+//
+// Checks that RadixSort orders draw items like std::stable_sort, serially and split
+// across a WorkerPool.
+// Usage: DrawQueueTests
+//***************************************************************************************
+
+#include "TestCommon.h"
+
+#include "DrawQueue.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool KeyLess(const DrawItem& a, const DrawItem& b)
+	{
+		return a.Key < b.Key;
+	}
+
+	// Few distinct keys spread over several digits, so most keys have many duplicates
+	// and the skipped-pass shortcut is exercised on the unused digits.
+	void RadixSortTest(size_t count, WorkerPool* pool, const char* what)
+	{
+		std::mt19937_64 random(3);
+		std::vector<DrawItem> items(count), scratch(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint64_t r = random();
+			items[i].Key = ((r & 3) << 60) | (((r >> 2) & 7) << 24) | ((r >> 5) & 1);
+			items[i].Payload = (uint32_t)i;
+			items[i].Reserved = 0;
+		}
+
+		std::vector<DrawItem> expected = items;
+		std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+		DrawItem* sorted = RadixSort(items.data(), scratch.data(), count, pool);
+		bool same = true;
+		for (size_t i = 0; i < count; ++i)
+			same &= sorted[i].Key == expected[i].Key && sorted[i].Payload == expected[i].Payload;
+		Test::Check(same, what);
+	}
+}
+
+int main()
+{
+	RadixSortTest(5000, nullptr, "radix sort: serial order differs from std::stable_sort");
+
+	// Large enough for RadixSort to split the work into several chunks.
+	WorkerPool pool(3);
+	RadixSortTest(100000, &pool, "radix sort: parallel order differs from std::stable_sort");
+
+	return Test::Finish();
+}
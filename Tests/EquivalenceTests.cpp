@@ -0,0 +1,306 @@
+//***************************************************************************************
+// EquivalenceTests.cpp
+//
+// Checks that the AVX2/F16C kernels give the same results as the scalar ones.  Both
+// paths run in this one binary: SetSimdLevel(SimdLevelScalar) forces the scalar
+// kernels.  On a CPU without AVX2 only the scalar reference checks run.
+// Usage: EquivalenceTests
+//***************************************************************************************
+
+#include "TestCommon.h"
+
+#include "CpuFeatures.h"
+#include "Geometry.h"
+#include "Texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool HaveAvx2()
+	{
+		return SupportedSimdLevel() == SimdLevelAvx2;
+	}
+
+	float FromBits(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	uint32_t ToBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	// Runs f once per SIMD level and fills scalar and simd with its results.
+	template<typename T, typename F>
+	void RunBothLevels(std::vector<T>& scalar, std::vector<T>& simd, F f)
+	{
+		SetSimdLevel(SimdLevelScalar);
+		f(scalar);
+		SetSimdLevel(SupportedSimdLevel());
+		f(simd);
+	}
+
+	template<typename T>
+	bool SameBits(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+	}
+
+	// Every 16-bit pattern, four per vertex position and two per texture coordinate.
+	template<typename T>
+	std::vector<T> AllPatterns()
+	{
+		std::vector<T> vertices(65536 / 4);
+		for (uint32_t i = 0; i < 65536; ++i)
+		{
+			memcpy(&vertices[i / 4].Position[i % 4], &i, 2);
+			uint16_t texCoord = (uint16_t)(i * 40503u);
+			memcpy(&vertices[i / 4].TexCoord[i % 2], &texCoord, 2);
+		}
+		return vertices;
+	}
+
+	// Random bit patterns, so NaNs, infinities and denormals all occur, followed by
+	// the values around the half-float rounding and range boundaries.
+	std::vector<VertexPositionTexture> PackInputs()
+	{
+		std::vector<uint32_t> bits;
+		std::mt19937 random(1);
+		for (int i = 0; i < 60000; ++i)
+			bits.push_back(random());
+		const uint32_t edges[] =
+		{
+			0x00000000, 0x80000000, 0x00000001, 0x007FFFFF, 0x33000000, 0x33000001, 0x337FFFFF,
+			0x38800000, 0x387FFFFF, 0x3F800000, 0x3F801000, 0x3F803000, 0x477FE000, 0x477FEFFF,
+			0x477FF000, 0x47800000, 0x7F800000, 0xFF800000, 0x7FC00000, 0x7F800001, 0xFFFFFFFF,
+		};
+		for (uint32_t edge : edges)
+		{
+			bits.push_back(edge);
+			bits.push_back(edge ^ 0x80000000);
+		}
+		// Exact multiples of 1/64 in [-2, 2] cover the clamped SNORM/UNORM ranges.
+		for (int i = -128; i <= 128; ++i)
+			bits.push_back(ToBits((float)i / 64.0f));
+
+		std::vector<VertexPositionTexture> vertices((bits.size() + 5) / 6);
+		for (size_t i = 0; i < 6 * vertices.size(); ++i)
+		{
+			float value = FromBits(bits[i % bits.size()]);
+			if (i % 6 < 4)
+				vertices[i / 6].Position[i % 6] = value;
+			else
+				vertices[i / 6].TexCoord[i % 6 - 4] = value;
+		}
+		return vertices;
+	}
+
+	void HalfTests()
+	{
+		std::vector<VertexPositionTextureHalf> halves = AllPatterns<VertexPositionTextureHalf>();
+		std::vector<VertexPositionTexture> scalar(halves.size()), simd(halves.size());
+		RunBothLevels(scalar, simd, [&](std::vector<VertexPositionTexture>& out)
+		{
+			UnpackVertices(halves.data(), halves.size(), out.data());
+		});
+		if (HaveAvx2())
+			Test::Check(SameBits(scalar, simd), "half unpack: scalar and F16C differ");
+
+		// Known values, and every non-NaN half survives a round trip.
+		Test::Check(ToBits(scalar[0x3C00 / 4].Position[0]) == 0x3F800000, "half unpack: 1.0");
+		Test::Check(scalar[0x7BFF / 4].Position[3] == 65504.0f, "half unpack: largest normal");
+		Test::Check(scalar[0].Position[1] == 1.0f / 16777216.0f, "half unpack: smallest denormal");
+		Test::Check(ToBits(scalar[0xFC00 / 4].Position[0]) == 0xFF800000, "half unpack: -infinity");
+
+		std::vector<VertexPositionTextureHalf> scalarPacked(halves.size()), simdPacked(halves.size());
+		RunBothLevels(scalarPacked, simdPacked, [&](std::vector<VertexPositionTextureHalf>& out)
+		{
+			PackVertices(scalar.data(), scalar.size(), out.data());
+		});
+		bool roundTrip = true;
+		for (uint32_t i = 0; i < 65536; ++i)
+		{
+			bool nan = (i & 0x7C00) == 0x7C00 && (i & 0x3FF) != 0;
+			roundTrip &= nan || scalarPacked[i / 4].Position[i % 4] == i;
+		}
+		Test::Check(roundTrip, "half pack: round trip of every half");
+		if (HaveAvx2())
+			Test::Check(SameBits(scalarPacked, simdPacked), "half pack of unpacked halves: scalar and F16C differ");
+
+		std::vector<VertexPositionTexture> inputs = PackInputs();
+		scalarPacked.resize(inputs.size());
+		simdPacked.resize(inputs.size());
+		RunBothLevels(scalarPacked, simdPacked, [&](std::vector<VertexPositionTextureHalf>& out)
+		{
+			PackVertices(inputs.data(), inputs.size(), out.data());
+		});
+		if (HaveAvx2())
+			Test::Check(SameBits(scalarPacked, simdPacked), "half pack: scalar and F16C differ");
+	}
+
+	void SnormTests()
+	{
+		std::vector<VertexPositionTextureSnorm> snorms = AllPatterns<VertexPositionTextureSnorm>();
+		std::vector<VertexPositionTexture> scalar(snorms.size()), simd(snorms.size());
+		RunBothLevels(scalar, simd, [&](std::vector<VertexPositionTexture>& out)
+		{
+			UnpackVertices(snorms.data(), snorms.size(), out.data());
+		});
+		if (HaveAvx2())
+			Test::Check(SameBits(scalar, simd), "snorm unpack: scalar and AVX2 differ");
+		Test::Check(scalar[0x8000 / 4].Position[0] == -1.0f && scalar[0x8001 / 4].Position[1] == -1.0f, "snorm unpack: -32768 and -32767");
+		Test::Check(scalar[0x7FFF / 4].Position[3] == 1.0f, "snorm unpack: 32767");
+
+		std::vector<VertexPositionTexture> inputs = PackInputs();
+		std::vector<VertexPositionTextureSnorm> scalarPacked(inputs.size()), simdPacked(inputs.size());
+		RunBothLevels(scalarPacked, simdPacked, [&](std::vector<VertexPositionTextureSnorm>& out)
+		{
+			PackVertices(inputs.data(), inputs.size(), out.data());
+		});
+		if (HaveAvx2())
+			Test::Check(SameBits(scalarPacked, simdPacked), "snorm pack: scalar and AVX2 differ");
+	}
+
+	void TextureTests(TextureFormat format, TextureLayout layout)
+	{
+		// Several swizzle blocks wide and high, and not a multiple of the block size.
+		const int Width = 150, Height = 90;
+		std::mt19937 random(2);
+		std::vector<uint32_t> image(Width * Height);
+		for (uint32_t& texel : image)
+			texel = random();
+
+		Texture texture;
+		texture.Create(Width, Height, format, 0, layout);
+		texture.Upload(image.data(), Width);
+
+		// Every texel must get its own address.
+		bool roundTrip = true;
+		for (int y = 0; y < Height; ++y)
+		{
+			for (int x = 0; x < Width; ++x)
+				roundTrip &= texture.Texel(0, x, y) == image[y * Width + x];
+		}
+
+		// Coordinates are multiples of 1/256 from just outside [0, 1] on both sides,
+		// so the scaled coordinates are exact and only the bilinear blend can differ.
+		std::vector<float> u, v;
+		for (int i = -40; i < 296; ++i)
+		{
+			for (int j = -24; j < 280; j += 7)
+			{
+				u.push_back((float)i / 256.0f);
+				v.push_back((float)j / 256.0f);
+			}
+		}
+
+		// Non-finite and huge coordinates, paired with each other and with in-range ones.
+		const float NaN = std::numeric_limits<float>::quiet_NaN();
+		const float Inf = std::numeric_limits<float>::infinity();
+		const float odd[] = { NaN, Inf, -Inf, 1e30f, -1e30f, 0.3f, -NaN, 0.7f };
+		for (int i = 0; i < 8; ++i)
+		{
+			for (int k = 0; k < 8; ++k)
+			{
+				u.push_back(odd[k]);
+				v.push_back(odd[(k + i) % 8]);
+			}
+		}
+
+		bool centres = true, nanClamped = true, pointSame = true, bilinearClose = true;
+		for (int level = 0; level < texture.MipLevels(); ++level)
+		{
+			int w = texture.Width(level), h = texture.Height(level);
+			for (int i = 0; i < 8; ++i)
+			{
+				float cu[8], cv[8];
+				uint32_t texels[8];
+				for (int k = 0; k < 8; ++k)
+				{
+					cu[k] = ((float)((i * 8 + k) % w) + 0.5f) / (float)w;
+					cv[k] = ((float)((i * 3 + k) % h) + 0.5f) / (float)h;
+				}
+				SetSimdLevel(SimdLevelScalar);
+				texture.SamplePoint8(level, cu, cv, texels);
+				for (int k = 0; k < 8; ++k)
+					centres &= texels[k] == texture.Texel(level, (i * 8 + k) % w, (i * 3 + k) % h);
+
+				// NaN clamps like a coordinate below the texture: column 0 or row 0.
+				float nan[8];
+				std::fill(nan, nan + 8, NaN);
+				texture.SamplePoint8(level, nan, cv, texels);
+				for (int k = 0; k < 8; ++k)
+					nanClamped &= texels[k] == texture.Texel(level, 0, (i * 3 + k) % h);
+				texture.SamplePoint8(level, cu, nan, texels);
+				for (int k = 0; k < 8; ++k)
+					nanClamped &= texels[k] == texture.Texel(level, (i * 8 + k) % w, 0);
+			}
+
+			for (size_t i = 0; i + 8 <= u.size(); i += 8)
+			{
+				uint32_t scalarTexels[8], simdTexels[8];
+				Color8 scalarPoint, simdPoint, scalarBilinear, simdBilinear;
+				SetSimdLevel(SimdLevelScalar);
+				texture.SamplePoint8(level, &u[i], &v[i], scalarTexels);
+				texture.SamplePoint8(level, &u[i], &v[i], scalarPoint);
+				texture.SampleBilinear8(level, &u[i], &v[i], scalarBilinear);
+				SetSimdLevel(SupportedSimdLevel());
+				texture.SamplePoint8(level, &u[i], &v[i], simdTexels);
+				texture.SamplePoint8(level, &u[i], &v[i], simdPoint);
+				texture.SampleBilinear8(level, &u[i], &v[i], simdBilinear);
+
+				pointSame &= memcmp(scalarTexels, simdTexels, sizeof(scalarTexels)) == 0;
+				pointSame &= memcmp(&scalarPoint, &simdPoint, sizeof(scalarPoint)) == 0;
+				const float* a = scalarBilinear.R;
+				const float* b = simdBilinear.R;
+				for (int k = 0; k < 32; ++k)
+					bilinearClose &= std::fabs(a[k] - b[k]) <= 1e-5f;
+			}
+		}
+
+		const char* name = format == TextureFormatD24UnormS8Uint ? "D24" : "RGBA";
+		const char* layoutName = layout == TextureLayoutTiled ? "tiled" : layout == TextureLayoutSwizzled ? "swizzled" : "linear";
+		char what[128];
+		snprintf(what, sizeof(what), "%s %s texture: texels read back after Upload", name, layoutName);
+		Test::Check(roundTrip, what);
+		snprintf(what, sizeof(what), "%s %s texture: point samples at texel centres", name, layoutName);
+		Test::Check(centres, what);
+		snprintf(what, sizeof(what), "%s %s texture: NaN coordinates sample the first column or row", name, layoutName);
+		Test::Check(nanClamped, what);
+		if (HaveAvx2())
+		{
+			snprintf(what, sizeof(what), "%s %s texture: scalar and AVX2 point samples differ", name, layoutName);
+			Test::Check(pointSame, what);
+			snprintf(what, sizeof(what), "%s %s texture: scalar and AVX2 bilinear samples differ", name, layoutName);
+			Test::Check(bilinearClose, what);
+		}
+	}
+}
+
+int main()
+{
+	printf("SIMD level: %s\n", HaveAvx2() ? "AVX2" : "scalar only, comparing against reference values");
+
+	HalfTests();
+	SnormTests();
+	for (TextureFormat format : { TextureFormatR8G8B8A8Unorm, TextureFormatD24UnormS8Uint })
+	{
+		TextureTests(format, TextureLayoutTiled);
+		TextureTests(format, TextureLayoutSwizzled);
+		TextureTests(format, TextureLayoutLinear);
+	}
+
+	return Test::Finish();
+}
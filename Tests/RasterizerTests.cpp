@@ -0,0 +1,195 @@
+//***************************************************************************************
+// RasterizerTests.cpp
+//
+// Checks the CPU backend's fill rule: meshes that cover the whole render target must
+// shade every pixel exactly once, with no holes or double hits on shared edges.
+// Usage: RasterizerTests
+//***************************************************************************************
+
+#include "TestCommon.h"
+
+#include "CpuBackend.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const float Black[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	void PassThroughVS(const void*, const VertexPositionTexture* input, VertexOutput* output, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			VertexOutput out = {};
+			for (int c = 0; c < 4; ++c)
+				out.Position[c] = input[i].Position[c];
+			output[i] = out;
+		}
+	}
+
+	// Counts how often each pixel is shaded.
+	void CountPS(const void*, const PixelSpan& span, uint32_t* colors)
+	{
+		for (int i = 0; i < span.Count; ++i)
+			++colors[i];
+	}
+
+	CpuPipeline CountPipeline()
+	{
+		CpuPipeline pipeline = {};
+		pipeline.Shader.VS = PassThroughVS;
+		pipeline.Shader.PS = CountPS;
+		pipeline.DepthState.DepthEnable = false;
+		pipeline.DepthState.DepthFunc = CpuComparisonAlways;
+		pipeline.CullMode = CpuCullNone;
+		return pipeline;
+	}
+
+	// Pixel-space point to clip space.
+	VertexPositionTexture Vertex(const CpuDevice& device, float x, float y)
+	{
+		VertexPositionTexture vertex = {};
+		vertex.Position[0] = x / (float)device.Width() * 2.0f - 1.0f;
+		vertex.Position[1] = 1.0f - y / (float)device.Height() * 2.0f;
+		vertex.Position[3] = 1.0f;
+		return vertex;
+	}
+
+	void Draw(CpuDevice& device, const std::vector<VertexPositionTexture>& strip)
+	{
+		CpuBufferHandle buffer = device.CreateBuffer(strip.data(), strip.size() * sizeof(VertexPositionTexture));
+		device.SetVertexBuffer(buffer);
+		device.Draw((uint32_t)strip.size(), 0);
+		device.DestroyBuffer(buffer);
+	}
+
+	bool EveryPixelOnce(CpuDevice& device)
+	{
+		const uint32_t* counts = device.ColorData();
+		for (size_t i = 0; i < (size_t)device.Width() * device.Height(); ++i)
+		{
+			if (counts[i] != 1)
+				return false;
+		}
+		return true;
+	}
+
+	// Two-triangle quads on the 1/256 grid D3D11 snaps to, partly off the render target.
+	// The shared diagonal runs through pixel centres P + k * (a, -b) while its ends sit
+	// at arbitrary subpixel offsets, so the fill rule decides many of its pixels.  With
+	// the top-left rule the rectangle covers exactly the centres in [x0, x1) x [y0, y1).
+	void QuadTest(WorkerPool* pool)
+	{
+		std::mt19937 random(4);
+		std::uniform_int_distribution<int> size(1, 300), step(1, 7), extent(1, 256 * 40);
+
+		CpuDevice device(pool);
+		device.SetPipeline(CountPipeline());
+		int failures = 0;
+		for (int quad = 0; quad < 200; ++quad)
+		{
+			device.Resize(size(random), size(random));
+			int w = device.Width(), h = device.Height();
+
+			// In 1/256 pixels: the corners are P - (u / 256) * (a, -b) and P + (v / 256) * (a, -b).
+			int px = 256 * std::uniform_int_distribution<int>(0, w - 1)(random) + 128;
+			int py = 256 * std::uniform_int_distribution<int>(0, h - 1)(random) + 128;
+			int a = step(random), b = step(random), u = extent(random), v = extent(random);
+			int x0 = px - u * a, y1 = py + u * b;
+			int x1 = px + v * a, y0 = py - v * b;
+
+			std::vector<VertexPositionTexture> strip =
+			{
+				Vertex(device, x0 / 256.0f, y0 / 256.0f),
+				Vertex(device, x1 / 256.0f, y0 / 256.0f),
+				Vertex(device, x0 / 256.0f, y1 / 256.0f),
+				Vertex(device, x1 / 256.0f, y1 / 256.0f),
+			};
+			device.ClearRenderTarget(Black);
+			Draw(device, strip);
+			device.EndFrame();
+
+			bool correct = true;
+			const uint32_t* counts = device.ColorData();
+			for (int y = 0; y < h; ++y)
+			{
+				for (int x = 0; x < w; ++x)
+				{
+					int cx = 256 * x + 128, cy = 256 * y + 128;
+					bool inside = x0 <= cx && cx < x1 && y0 <= cy && cy < y1;
+					correct &= counts[y * w + x] == (inside ? 1u : 0u);
+				}
+			}
+			failures += correct ? 0 : 1;
+		}
+
+		char what[128];
+		snprintf(what, sizeof(what), "quads: %d of 200 are not covered exactly once", failures);
+		Test::Check(failures == 0, what);
+	}
+
+	// A grid of jittered vertices, drawn one strip per row, gives shared edges in every
+	// direction and vertices at arbitrary subpixel positions.
+	void GridTest(WorkerPool* pool)
+	{
+		const int Cells = 12;
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+
+		CpuDevice device(pool);
+		device.SetPipeline(CountPipeline());
+		int failures = 0;
+		for (int grid = 0; grid < 50; ++grid)
+		{
+			device.Resize(97 + grid, 61 + 2 * grid);
+			device.ClearRenderTarget(Black);
+			float cellW = (float)device.Width() / Cells, cellH = (float)device.Height() / Cells;
+
+			std::vector<VertexPositionTexture> points((Cells + 1) * (Cells + 1));
+			for (int j = 0; j <= Cells; ++j)
+			{
+				for (int i = 0; i <= Cells; ++i)
+				{
+					// Outer vertices stay outside the render target.
+					float x = i == 0 ? -1.0f : i == Cells ? (float)device.Width() + 1.0f : (i + jitter(random)) * cellW;
+					float y = j == 0 ? -1.0f : j == Cells ? (float)device.Height() + 1.0f : (j + jitter(random)) * cellH;
+					points[j * (Cells + 1) + i] = Vertex(device, x, y);
+				}
+			}
+
+			for (int j = 0; j < Cells; ++j)
+			{
+				std::vector<VertexPositionTexture> strip;
+				for (int i = 0; i <= Cells; ++i)
+				{
+					strip.push_back(points[j * (Cells + 1) + i]);
+					strip.push_back(points[(j + 1) * (Cells + 1) + i]);
+				}
+				Draw(device, strip);
+			}
+			device.EndFrame();
+			failures += EveryPixelOnce(device) ? 0 : 1;
+		}
+
+		char what[128];
+		snprintf(what, sizeof(what), "grids: %d of 50 have a pixel shaded other than once", failures);
+		Test::Check(failures == 0, what);
+	}
+}
+
+int main()
+{
+	QuadTest(nullptr);
+	GridTest(nullptr);
+
+	// Bands split across threads must not change coverage.
+	WorkerPool pool(3);
+	QuadTest(&pool);
+	GridTest(&pool);
+
+	return Test::Finish();
+}
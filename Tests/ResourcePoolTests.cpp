@@ -0,0 +1,152 @@
+//***************************************************************************************
+// ResourcePoolTests.cpp
+//
+// Checks ResourcePool's handle validation and the lifetime of pooled values: stale
+// handles are rejected, reused slots get a new generation, Destroy() defers the deleter
+// until Collect() sees the fence, and a full pool hands the value straight back.
+// Usage: ResourcePoolTests
+//***************************************************************************************
+
+#include "TestCommon.h"
+
+#include "ResourcePool.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Values handed to the deleter, in order.
+	std::vector<int>& Deleted()
+	{
+		static std::vector<int> values;
+		return values;
+	}
+
+	struct RecordingDeleter
+	{
+		void operator()(int value)const
+		{
+			Deleted().push_back(value);
+		}
+	};
+
+	typedef ResourcePool<int, RecordingDeleter> IntPool;
+	typedef IntPool::HandleType IntHandle;
+
+	void StaleHandleTest()
+	{
+		Deleted().clear();
+		IntPool pool;
+		IntHandle a = pool.Create(10), b = pool.Create(20), c = pool.Create(30);
+		Test::Check(pool.Get(IntHandle()) == nullptr, "stale handles: the null handle resolves to a value");
+		Test::Check(pool.Get(IntHandle(7, 1)) == nullptr, "stale handles: a handle past the last slot resolves to a value");
+
+		// Destroying the first value moves the last one into its dense slot.
+		pool.Destroy(a, 0);
+		pool.Collect(0);
+		Test::Check(!pool.IsValid(a) && pool.Get(a) == nullptr, "stale handles: a destroyed handle still resolves");
+		Test::Check(pool.Get(b) && *pool.Get(b) == 20 && pool.Get(c) && *pool.Get(c) == 30,
+			"stale handles: live values moved while compacting resolve to the wrong value");
+		Test::Check(pool.Size() == 2, "stale handles: size after destroy");
+
+		// A second Destroy through the stale handle must not touch the live values.
+		pool.Destroy(a, 0);
+		pool.Collect(0);
+		Test::Check(Deleted() == std::vector<int>{ 10 } && pool.Size() == 2, "stale handles: destroying a stale handle deleted a value");
+	}
+
+	void GenerationTest()
+	{
+		Deleted().clear();
+		IntPool pool;
+		IntHandle first = pool.Create(1);
+		pool.Destroy(first, 0);
+		IntHandle second = pool.Create(2);
+
+		Test::Check(second.Index() == first.Index(), "generations: the freed slot is not reused");
+		Test::Check(second.Generation() == first.Generation() + 1, "generations: reusing a slot does not bump its generation");
+		Test::Check(pool.Get(first) == nullptr, "generations: the old handle resolves to the slot's new value");
+		Test::Check(pool.Get(second) && *pool.Get(second) == 2, "generations: the new handle does not resolve");
+	}
+
+	void DeferredDestroyTest()
+	{
+		Deleted().clear();
+		IntPool pool;
+		IntHandle early = pool.Create(1), late = pool.Create(2);
+		pool.Destroy(late, 6);
+		pool.Destroy(early, 5);
+
+		Test::Check(pool.Get(early) == nullptr && pool.Get(late) == nullptr, "deferred destroy: a destroyed handle resolves before Collect");
+		Test::Check(Deleted().empty() && pool.RetiredSize() == 2, "deferred destroy: the deleter ran before Collect");
+
+		pool.Collect(4);
+		Test::Check(Deleted().empty(), "deferred destroy: Collect deleted a value whose fence has not completed");
+		pool.Collect(5);
+		Test::Check(Deleted() == std::vector<int>{ 1 } && pool.RetiredSize() == 1,
+			"deferred destroy: Collect did not delete exactly the values whose fence completed");
+		pool.Collect(100);
+		Test::Check(Deleted() == (std::vector<int>{ 1, 2 }) && pool.RetiredSize() == 0,
+			"deferred destroy: a later Collect did not delete the remaining value");
+	}
+
+	void OverflowTest()
+	{
+		Deleted().clear();
+		ErrorRecord record;
+		while (GlobalErrorRing().Pop(record))
+		{
+		}
+
+		IntPool pool;
+		pool.Reserve(IntPool::MaxSize);
+		bool allIssued = true;
+		for (uint32_t i = 0; i < IntPool::MaxSize; ++i)
+			allIssued &= !pool.Create((int)i).IsNull();
+		Test::Check(allIssued && pool.Size() == IntPool::MaxSize, "overflow: the pool did not fill to MaxSize");
+
+		IntHandle overflow = pool.Create(-1);
+		Test::Check(overflow.IsNull(), "overflow: a full pool issued a handle");
+		Test::Check(Deleted() == std::vector<int>{ -1 }, "overflow: the rejected value was not handed to the deleter");
+		Test::Check(GlobalErrorRing().Pop(record) && record.Code == StatusOutOfMemory,
+			"overflow: StatusOutOfMemory was not recorded");
+		Test::Check(pool.Size() == IntPool::MaxSize, "overflow: a rejected value changed the size");
+
+		// Freeing one slot makes room again.
+		pool.Destroy(IntHandle(0, 1), 0);
+		Test::Check(!pool.Create(-2).IsNull(), "overflow: no handle after a slot was freed");
+	}
+
+	void DestroyAllTest()
+	{
+		Deleted().clear();
+		{
+			IntPool pool;
+			IntHandle live = pool.Create(1), retired = pool.Create(2);
+			pool.Destroy(retired, 9);
+			pool.DestroyAll();
+
+			std::vector<int> deleted = Deleted();
+			std::sort(deleted.begin(), deleted.end());
+			Test::Check(deleted == (std::vector<int>{ 1, 2 }), "DestroyAll: live and retired values were not all deleted");
+			Test::Check(pool.Size() == 0 && pool.RetiredSize() == 0, "DestroyAll: values left in the pool");
+			Test::Check(pool.Get(live) == nullptr, "DestroyAll: a handle issued before still resolves");
+
+			IntHandle again = pool.Create(3);
+			Test::Check(again != live && pool.Get(again) && *pool.Get(again) == 3, "DestroyAll: the emptied pool does not issue fresh handles");
+		}
+		Test::Check(Deleted().size() == 3 && Deleted().back() == 3, "DestroyAll: the destructor did not delete the remaining value");
+	}
+}
+
+int main()
+{
+	StaleHandleTest();
+	GenerationTest();
+	DeferredDestroyTest();
+	OverflowTest();
+	DestroyAllTest();
+
+	return Test::Finish();
+}
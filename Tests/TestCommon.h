@@ -0,0 +1,41 @@
+//***************************************************************************************
+// TestCommon.h
+//
+// Failure counting and reporting shared by the test executables.  A test calls
+// Test::Check for each condition and returns Test::Finish() from main, so ctest sees a
+// nonzero exit code when any check failed.
+//***************************************************************************************
+
+#ifndef TESTCOMMON_H
+#define TESTCOMMON_H
+
+#include <cstdio>
+
+namespace Test
+{
+	inline int& Failures()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline void Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			printf("FAILED: %s\n", what);
+			++Failures();
+		}
+	}
+
+	inline int Finish()
+	{
+		if (Failures())
+			printf("%d check(s) failed\n", Failures());
+		else
+			printf("All checks passed\n");
+		return Failures() ? 1 : 0;
+	}
+}
+
+#endif // TESTCOMMON_H
@@ -0,0 +1,243 @@
+//***************************************************************************************
+// Texture.cpp
+//***************************************************************************************
+
+#include "Texture.h"
+#include "CpuFeatures.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const uint32_t DepthMask = 0xFFFFFF;
+	const float DepthScale = 1.0f / (float)DepthMask;
+	const float UnormScale = 1.0f / 255.0f;
+
+	inline int Clamp(int value, int low, int high)
+	{
+		return std::min(std::max(value, low), high);
+	}
+
+	// Clamps a texel-space coordinate to [-1, size], which keeps the float -> int
+	// conversion in range.  NaN fails the compare and goes to -1, as in the AVX2 path.
+	inline float ClampCoordinate(float value, int size)
+	{
+		return !(value >= -1.0f) ? -1.0f : std::min(value, (float)size);
+	}
+
+	uint32_t AverageR8G8B8A8(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		uint32_t result = 0;
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			uint32_t sum = ((a >> shift) & 255) + ((b >> shift) & 255) + ((c >> shift) & 255) + ((d >> shift) & 255);
+			result |= ((sum + 2) >> 2) << shift;
+		}
+		return result;
+	}
+
+	uint32_t FarthestD24(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		uint32_t depth = std::max(std::max(a & DepthMask, b & DepthMask), std::max(c & DepthMask, d & DepthMask));
+		return (a & ~DepthMask) | depth;
+	}
+
+}
+
+Texture::Texture() :
+	mFormat(TextureFormatR8G8B8A8Unorm),
+	mLayout(TextureLayoutTiled),
+	mMipLevels(0)
+{
+	for (int i = 0; i < MaxMipLevels; ++i)
+		mLevels[i] = Level{ 0, 0, 0, 0 };
+}
+
+void Texture::Create(int width, int height, TextureFormat format, int mipLevels, TextureLayout layout)
+{
+	mFormat = format;
+	mLayout = layout;
+
+	int fullChain = 1;
+	for (int size = std::max(width, height); size > 1; size >>= 1)
+		++fullChain;
+	mMipLevels = std::min(mipLevels > 0 ? std::min(mipLevels, fullChain) : fullChain, (int)MaxMipLevels);
+
+	size_t offset = 0;
+	for (int i = 0; i < mMipLevels; ++i)
+	{
+		Level& level = mLevels[i];
+		level.Width = std::max(1, width >> i);
+		level.Height = std::max(1, height >> i);
+		level.Offset = offset;
+
+		if (layout == TextureLayoutLinear)
+		{
+			level.Pitch = level.Width;
+			offset += (size_t)level.Width * level.Height;
+		}
+		else if (layout == TextureLayoutTiled)
+		{
+			int tilesX = (level.Width + TileSize - 1) >> TileShift;
+			int tilesY = (level.Height + TileSize - 1) >> TileShift;
+			level.Pitch = tilesX;
+			offset += (size_t)tilesX * tilesY * TileSize * TileSize;
+		}
+		else
+		{
+			int blocksX = (level.Width + BlockSize - 1) / BlockSize;
+			int blocksY = (level.Height + BlockSize - 1) / BlockSize;
+			level.Pitch = blocksX;
+			offset += (size_t)blocksX * blocksY * BlockSize * BlockSize;
+		}
+	}
+
+	mTexels.assign(offset, 0);
+}
+
+void Texture::Upload(const uint32_t* texels, int pitch)
+{
+	const Level& level = mLevels[0];
+	for (int y = 0; y < level.Height; ++y)
+	{
+		const uint32_t* row = texels + (size_t)y * pitch;
+		for (int x = 0; x < level.Width; ++x)
+			SetTexel(0, x, y, row[x]);
+	}
+
+	GenerateMips();
+}
+
+void Texture::GenerateMips()
+{
+	for (int i = 1; i < mMipLevels; ++i)
+	{
+		const Level& source = mLevels[i - 1];
+		const Level& level = mLevels[i];
+		for (int y = 0; y < level.Height; ++y)
+		{
+			int y0 = std::min(2 * y, source.Height - 1), y1 = std::min(2 * y + 1, source.Height - 1);
+			for (int x = 0; x < level.Width; ++x)
+			{
+				int x0 = std::min(2 * x, source.Width - 1), x1 = std::min(2 * x + 1, source.Width - 1);
+				uint32_t a = Texel(i - 1, x0, y0), b = Texel(i - 1, x1, y0);
+				uint32_t c = Texel(i - 1, x0, y1), d = Texel(i - 1, x1, y1);
+
+				SetTexel(i, x, y, mFormat == TextureFormatD24UnormS8Uint ? FarthestD24(a, b, c, d) : AverageR8G8B8A8(a, b, c, d));
+			}
+		}
+	}
+}
+
+void Texture::Addresses8(const Level& level, const int* x, const int* y, int* addresses)const
+{
+	for (int i = 0; i < 8; ++i)
+		addresses[i] = (int)Address(level, x[i], y[i]);
+}
+
+void Texture::Decode8(const uint32_t* texels, Color8& color)const
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		uint32_t t = texels[i];
+		if (mFormat == TextureFormatD24UnormS8Uint)
+		{
+			color.R[i] = (float)(t & DepthMask) * DepthScale;
+			color.G[i] = 0.0f;
+			color.B[i] = 0.0f;
+			color.A[i] = 1.0f;
+		}
+		else
+		{
+			color.R[i] = (float)(t & 255) * UnormScale;
+			color.G[i] = (float)((t >> 8) & 255) * UnormScale;
+			color.B[i] = (float)((t >> 16) & 255) * UnormScale;
+			color.A[i] = (float)(t >> 24) * UnormScale;
+		}
+	}
+}
+
+void Texture::SamplePoint8(int level, const float* u, const float* v, uint32_t* texels)const
+{
+	const Level& l = mLevels[level];
+	const uint32_t* base = mTexels.data() + l.Offset;
+
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		SamplePoint8Avx2(TextureLevelView{ base, l.Width, l.Height, l.Pitch, mLayout, mFormat }, u, v, texels);
+		return;
+	}
+#endif
+
+	int x[8], y[8], addresses[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		float fx = ClampCoordinate(u[i] * (float)l.Width, l.Width);
+		float fy = ClampCoordinate(v[i] * (float)l.Height, l.Height);
+		x[i] = Clamp((int)std::floor(fx), 0, l.Width - 1);
+		y[i] = Clamp((int)std::floor(fy), 0, l.Height - 1);
+	}
+	Addresses8(l, x, y, addresses);
+	for (int i = 0; i < 8; ++i)
+		texels[i] = base[addresses[i]];
+}
+
+void Texture::SamplePoint8(int level, const float* u, const float* v, Color8& color)const
+{
+	uint32_t texels[8];
+	SamplePoint8(level, u, v, texels);
+	Decode8(texels, color);
+}
+
+void Texture::SampleBilinear8(int level, const float* u, const float* v, Color8& color)const
+{
+	const Level& l = mLevels[level];
+	const uint32_t* base = mTexels.data() + l.Offset;
+
+#if defined(DXCRASH_HAVE_AVX2)
+	if (ActiveSimdLevel() == SimdLevelAvx2)
+	{
+		SampleBilinear8Avx2(TextureLevelView{ base, l.Width, l.Height, l.Pitch, mLayout, mFormat }, u, v, color);
+		return;
+	}
+#endif
+
+	int x0[8], y0[8], x1[8], y1[8];
+	float tx[8], ty[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		float fx = ClampCoordinate(u[i] * (float)l.Width - 0.5f, l.Width);
+		float fy = ClampCoordinate(v[i] * (float)l.Height - 0.5f, l.Height);
+		float floorX = std::floor(fx), floorY = std::floor(fy);
+		tx[i] = fx - floorX;
+		ty[i] = fy - floorY;
+		x0[i] = Clamp((int)floorX, 0, l.Width - 1);
+		y0[i] = Clamp((int)floorY, 0, l.Height - 1);
+		x1[i] = Clamp((int)floorX + 1, 0, l.Width - 1);
+		y1[i] = Clamp((int)floorY + 1, 0, l.Height - 1);
+	}
+
+	int addresses[8];
+	uint32_t texels[8];
+	Color8 c[4];
+	const int* xs[4] = { x0, x1, x0, x1 };
+	const int* ys[4] = { y0, y0, y1, y1 };
+	for (int corner = 0; corner < 4; ++corner)
+	{
+		Addresses8(l, xs[corner], ys[corner], addresses);
+		for (int i = 0; i < 8; ++i)
+			texels[i] = base[addresses[i]];
+		Decode8(texels, c[corner]);
+	}
+
+	for (int i = 0; i < 8; ++i)
+	{
+		color.R[i] = (c[0].R[i] + (c[1].R[i] - c[0].R[i]) * tx[i]) * (1 - ty[i]) + (c[2].R[i] + (c[3].R[i] - c[2].R[i]) * tx[i]) * ty[i];
+		color.G[i] = (c[0].G[i] + (c[1].G[i] - c[0].G[i]) * tx[i]) * (1 - ty[i]) + (c[2].G[i] + (c[3].G[i] - c[2].G[i]) * tx[i]) * ty[i];
+		color.B[i] = (c[0].B[i] + (c[1].B[i] - c[0].B[i]) * tx[i]) * (1 - ty[i]) + (c[2].B[i] + (c[3].B[i] - c[2].B[i]) * tx[i]) * ty[i];
+		color.A[i] = (c[0].A[i] + (c[1].A[i] - c[0].A[i]) * tx[i]) * (1 - ty[i]) + (c[2].A[i] + (c[3].A[i] - c[2].A[i]) * tx[i]) * ty[i];
+	}
+}
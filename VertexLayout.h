@@ -0,0 +1,140 @@
+//***************************************************************************************
+// VertexLayout.h
+//
+// Compile-time vertex layouts.  A vertex type lists its elements once as
+// VertexLayout<VertexElement<Encoding, Semantic>...>; offsets, stride and the input
+// element descriptors are derived from that list, and CheckVertexElement verifies the
+// C++ struct against it, so the struct and the D3D input layout cannot drift apart.
+//***************************************************************************************
+
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Values match DXGI_FORMAT.
+enum VertexFormat
+{
+	VertexFormatR32G32B32A32Float = 2,
+	VertexFormatR32G32B32Float = 6,
+	VertexFormatR16G16B16A16Float = 10,
+	VertexFormatR16G16B16A16Snorm = 13,
+	VertexFormatR32G32Float = 16,
+	VertexFormatR16G16Float = 34,
+	VertexFormatR16G16Unorm = 35,
+};
+
+enum VertexSemantic
+{
+	VertexSemanticPosition,
+	VertexSemanticTexCoord,
+	VertexSemanticColor,
+};
+
+constexpr const char* VertexSemanticName(VertexSemantic semantic)
+{
+	switch (semantic)
+	{
+	case VertexSemanticPosition:
+		return "POSITION";
+	case VertexSemanticTexCoord:
+		return "TEXCOORD";
+	default:
+		return "COLOR";
+	}
+}
+
+// How one element is stored: Components values of type Component.
+template<typename T, int N, VertexFormat F>
+struct VertexEncoding
+{
+	typedef T Component;
+	typedef T Storage[N];
+
+	static const int Components = N;
+	static const VertexFormat Format = F;
+	static const unsigned Size = sizeof(T) * N;
+};
+
+typedef VertexEncoding<float, 4, VertexFormatR32G32B32A32Float> VertexFloat4;
+typedef VertexEncoding<float, 3, VertexFormatR32G32B32Float> VertexFloat3;
+typedef VertexEncoding<float, 2, VertexFormatR32G32Float> VertexFloat2;
+typedef VertexEncoding<uint16_t, 4, VertexFormatR16G16B16A16Float> VertexHalf4;
+typedef VertexEncoding<uint16_t, 2, VertexFormatR16G16Float> VertexHalf2;
+typedef VertexEncoding<int16_t, 4, VertexFormatR16G16B16A16Snorm> VertexSnorm16x4;
+typedef VertexEncoding<uint16_t, 2, VertexFormatR16G16Unorm> VertexUnorm16x2;
+
+template<typename E, VertexSemantic S, unsigned I = 0>
+struct VertexElement
+{
+	typedef E Encoding;
+
+	static const VertexSemantic Semantic = S;
+	static const unsigned SemanticIndex = I;
+};
+
+// API-neutral input element; the D3D11 app turns it into D3D11_INPUT_ELEMENT_DESC.
+struct VertexElementDesc
+{
+	const char* SemanticName;
+	unsigned SemanticIndex;
+	VertexFormat Format;
+	unsigned AlignedByteOffset;
+};
+
+// Elements are packed back to back in declaration order.
+template<typename... Elements>
+constexpr unsigned VertexElementOffset(unsigned index)
+{
+	const unsigned sizes[] = { Elements::Encoding::Size... };
+	unsigned offset = 0;
+	for (unsigned i = 0; i < index && i < sizeof...(Elements); ++i)
+		offset += sizes[i];
+	return offset;
+}
+
+// The input element table of a layout, a constant array built from the element list.
+template<typename Indices, typename... Elements>
+struct VertexElementTable;
+
+template<size_t... Indices, typename... Elements>
+struct VertexElementTable<std::index_sequence<Indices...>, Elements...>
+{
+	static constexpr VertexElementDesc InputElements[] =
+	{
+		{ VertexSemanticName(Elements::Semantic), Elements::SemanticIndex, Elements::Encoding::Format,
+			VertexElementOffset<Elements...>(Indices) }...
+	};
+};
+
+template<size_t... Indices, typename... Elements>
+constexpr VertexElementDesc VertexElementTable<std::index_sequence<Indices...>, Elements...>::InputElements[];
+
+template<typename... Elements>
+struct VertexLayout : VertexElementTable<std::make_index_sequence<sizeof...(Elements)>, Elements...>
+{
+	static const unsigned ElementCount = sizeof...(Elements);
+
+	template<unsigned Index>
+	using Element = typename std::tuple_element<Index, std::tuple<Elements...>>::type;
+
+	static constexpr unsigned Offset(unsigned index)
+	{
+		return VertexElementOffset<Elements...>(index);
+	}
+
+	static const unsigned Stride = VertexElementOffset<Elements...>(sizeof...(Elements));
+};
+
+// Checks that Vertex::member is element index of Vertex::Layout, in type and offset.
+#define CheckVertexElement(Vertex, index, member) \
+	static_assert(std::is_same<decltype(Vertex::member), Vertex::Layout::Element<index>::Encoding::Storage>::value, \
+		#Vertex "::" #member " does not have the type its layout declares."); \
+	static_assert(offsetof(Vertex, member) == Vertex::Layout::Offset(index), \
+		#Vertex "::" #member " is not at the offset its layout declares.")
+
+#endif // VERTEXLAYOUT_H
@@ -0,0 +1,110 @@
+//***************************************************************************************
+// WorkerPool.cpp
+//***************************************************************************************
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+{
+	unsigned hardwareThreads = std::thread::hardware_concurrency();
+	Start(hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+}
+
+WorkerPool::WorkerPool(unsigned workerCount)
+{
+	Start(workerCount);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWake.notify_all();
+
+	for (size_t i = 0; i < mThreads.size(); ++i)
+	{
+		mThreads[i].join();
+	}
+}
+
+void WorkerPool::Start(unsigned workerCount)
+{
+	mThreads.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; ++i)
+	{
+		mThreads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+void WorkerPool::Run(unsigned taskCount, TaskFunction function, void* context)
+{
+	if (mThreads.empty() || taskCount <= 1)
+	{
+		for (unsigned i = 0; i < taskCount; ++i)
+		{
+			function(context, i);
+		}
+		return;
+	}
+
+	{
+		// A worker that woke up late for the previous loop may still be in Work().
+		std::unique_lock<std::mutex> lock(mMutex);
+		mIdle.wait(lock, [this] { return mActive == 0; });
+
+		mFunction = function;
+		mContext = context;
+		mTaskCount = taskCount;
+		mPending.store(taskCount, std::memory_order_relaxed);
+		mNext.store(0, std::memory_order_relaxed);
+		++mGeneration;
+	}
+	mWake.notify_all();
+
+	Work();
+
+	while (mPending.load(std::memory_order_acquire) != 0)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void WorkerPool::Work()
+{
+	for (;;)
+	{
+		unsigned index = mNext.fetch_add(1, std::memory_order_relaxed);
+		if (index >= mTaskCount)
+			break;
+
+		mFunction(mContext, index);
+		mPending.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void WorkerPool::WorkerLoop()
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [&] { return mStop || mGeneration != seen; });
+			if (mStop)
+				return;
+
+			seen = mGeneration;
+			++mActive;
+		}
+
+		Work();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (--mActive == 0)
+				mIdle.notify_one();
+		}
+	}
+}
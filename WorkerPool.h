@@ -0,0 +1,65 @@
+//***************************************************************************************
+// WorkerPool.h
+//
+// Persistent worker threads for fork/join loops.  The calling thread takes part in
+// every ParallelFor, so a pool with zero workers simply runs the loop inline.
+//***************************************************************************************
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	// Defaults to one worker per hardware thread besides the caller.
+	WorkerPool();
+	explicit WorkerPool(unsigned workerCount);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Number of threads that execute a ParallelFor, including the caller.
+	unsigned Concurrency()const { return (unsigned)mThreads.size() + 1; }
+
+	// Calls body(i) for i in [0, taskCount) and returns once all calls have finished.
+	// Does not allocate.
+	template<typename F>
+	void ParallelFor(unsigned taskCount, F& body)
+	{
+		Run(taskCount, [](void* context, unsigned index) { (*static_cast<F*>(context))(index); }, &body);
+	}
+
+private:
+	typedef void (*TaskFunction)(void* context, unsigned index);
+
+	void Start(unsigned workerCount);
+	void Run(unsigned taskCount, TaskFunction function, void* context);
+	void Work();
+	void WorkerLoop();
+
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mIdle;
+	uint64_t mGeneration = 0;
+	unsigned mActive = 0;
+	bool mStop = false;
+
+	// Only written while no worker is inside Work().
+	TaskFunction mFunction = nullptr;
+	void* mContext = nullptr;
+	unsigned mTaskCount = 0;
+
+	std::atomic<unsigned> mNext{0};
+	std::atomic<unsigned> mPending{0};
+};
+
+#endif // WORKERPOOL_H